@@ -0,0 +1,52 @@
+#include "async_mesh_load.h"
+
+#include <exception>
+
+
+AsyncMeshLoad::AsyncMeshLoad(const std::string& path, ThreadPool& pool, const MeshLoadOptions& options)
+    : sourcePath(path), status(LOADING), cancelled(false), started(std::chrono::steady_clock::now()),
+      taskFinished(false) {
+    MeshLoadOptions taskOptions = options;
+    pool.submit([this, taskOptions] { run(taskOptions); });
+}
+
+AsyncMeshLoad::~AsyncMeshLoad() {
+    cancelled.store(true);
+    std::unique_lock<std::mutex> lock(taskMutex);
+    taskDone.wait(lock, [this] { return taskFinished; });
+}
+
+double AsyncMeshLoad::elapsedMs() const {
+    std::chrono::steady_clock::time_point end = (state() == LOADING) ? std::chrono::steady_clock::now() : finished;
+    return std::chrono::duration<double, std::milli>(end - started).count();
+}
+
+void AsyncMeshLoad::run(const MeshLoadOptions& options) {
+    State outcome = FAILED;
+    if (cancelled.load()) {
+        errorMessage = "Load of " + sourcePath + " was cancelled.";
+    }
+    else {
+        MeshLoadOptions taskOptions = options;
+        taskOptions.progress = &progress;
+        try {
+            if (loadModel(sourcePath, result, taskOptions)) {
+                outcome = READY;
+            }
+            else {
+                errorMessage = "Failed to load model: " + sourcePath;
+            }
+        }
+        catch (const std::exception& e) {
+            errorMessage = std::string("Error loading model '") + sourcePath + "': " + e.what();
+        }
+    }
+    finished = std::chrono::steady_clock::now();
+    // Release pairs with the acquire in state(): the mesh and error message
+    // are complete before the GL thread can observe READY/FAILED.
+    status.store(outcome, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(taskMutex);
+    taskFinished = true;
+    taskDone.notify_all();
+}
@@ -0,0 +1,58 @@
+#ifndef ASYNC_MESH_LOAD_H
+#define ASYNC_MESH_LOAD_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#include "mesh.h"
+#include "thread_pool.h"
+
+// Runs loadModel as a ThreadPool task so the render loop keeps presenting
+// frames while models are parsed. The GL thread polls state() each frame and
+// uploads mesh() once it reports READY; nothing here touches GL.
+class AsyncMeshLoad {
+public:
+    enum State { LOADING, READY, FAILED };
+
+    AsyncMeshLoad(const std::string& path, ThreadPool& pool, const MeshLoadOptions& options = MeshLoadOptions());
+    // Blocks until the task has run (or skipped itself if it never started).
+    ~AsyncMeshLoad();
+
+    State state() const { return static_cast<State>(status.load(std::memory_order_acquire)); }
+    const char* stageName() const { return meshLoadStageName(progress.stage.load()); }
+    double elapsedMs() const;
+
+    const std::string& path() const { return sourcePath; }
+    // The coarse preview the loader published (MeshLoadOptions::previewCells),
+    // or null until it has. Stays valid while this object lives.
+    const MeshData* preview() const {
+        return progress.previewReady.load(std::memory_order_acquire) ? progress.preview.get() : nullptr;
+    }
+    // Only valid once state() != LOADING.
+    MeshData& mesh() { return result; }
+    const std::string& error() const { return errorMessage; }
+
+private:
+    AsyncMeshLoad(const AsyncMeshLoad&);
+    AsyncMeshLoad& operator=(const AsyncMeshLoad&);
+
+    void run(const MeshLoadOptions& options);
+
+    std::string sourcePath;
+    MeshData result;
+    std::string errorMessage;
+    MeshLoadProgress progress;
+    std::atomic<int> status;
+    std::atomic<bool> cancelled;
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::time_point finished;
+
+    std::mutex taskMutex;
+    std::condition_variable taskDone;
+    bool taskFinished;
+};
+
+#endif
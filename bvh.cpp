@@ -0,0 +1,292 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const int SAH_BINS = 16;
+const size_t MAX_LEAF_TRIANGLES = 8;
+// Nodes this small become leaves without a split search; searching them
+// doubled the build time and didn't make rays any faster.
+const size_t MIN_SPLIT_TRIANGLES = 5;
+// Cost of visiting a node relative to one ray/triangle test.
+const float TRAVERSAL_COST = 1.0f;
+
+struct Box {
+    glm::vec3 lo = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 hi = glm::vec3(-std::numeric_limits<float>::max());
+
+    void grow(const glm::vec3& p) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+
+    void grow(const Box& box) {
+        lo = glm::min(lo, box.lo);
+        hi = glm::max(hi, box.hi);
+    }
+
+    float area() const {
+        glm::vec3 d = hi - lo;
+        return d.x < 0.0f ? 0.0f : d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+};
+
+// A triangle's bounds, kept next to it so the partitions below sweep memory
+// in order.
+struct Reference {
+    Box box;
+    glm::vec3 centroid;
+    unsigned int triangle;
+};
+
+struct Bin {
+    Box box;
+    Box centroids;
+    size_t count = 0;
+};
+
+class BvhBuilder {
+public:
+    BvhBuilder(const MeshData& meshData, std::vector<BvhNode>& nodes, std::vector<unsigned int>& triangles)
+        : nodes(nodes), triangles(triangles) {
+        const Vertex* vertices = meshData.vertexData();
+        const unsigned int* indices = meshData.indexData();
+        size_t triangleCount = meshData.baseIndexCount() / 3;
+        references.resize(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            Reference& reference = references[t];
+            for (int k = 0; k < 3; ++k) reference.box.grow(vertices[indices[3 * t + k]].Position);
+            reference.centroid = 0.5f * (reference.box.lo + reference.box.hi);
+            reference.triangle = static_cast<unsigned int>(t);
+        }
+    }
+
+    void build() {
+        nodes.clear();
+        triangles.clear();
+        if (references.empty()) return;
+        nodes.emplace_back();
+        // Explicit work list: skewed splits can nest deeper than the stack
+        // should. Each task carries its bounds, found while binning the
+        // parent, so no node rescans its triangles for them.
+        std::vector<Task> work(1, measure(0, 0, references.size()));
+        while (!work.empty()) {
+            Task task = work.back();
+            work.pop_back();
+            Task left, right;
+            if (!split(task, left, right)) continue;
+            left.node = nodes.size();
+            right.node = left.node + 1;
+            nodes[task.node].first = static_cast<unsigned int>(left.node);
+            nodes.resize(left.node + 2);
+            work.push_back(right);
+            work.push_back(left);
+        }
+        triangles.resize(references.size());
+        for (size_t i = 0; i < references.size(); ++i) triangles[i] = references[i].triangle;
+    }
+
+private:
+    struct Task {
+        size_t node = 0, begin = 0, end = 0;
+        Box bounds, centroidBounds;
+    };
+
+    Task measure(size_t node, size_t begin, size_t end) const {
+        Task task;
+        task.node = node;
+        task.begin = begin;
+        task.end = end;
+        for (size_t i = begin; i < end; ++i) {
+            task.bounds.grow(references[i].box);
+            task.centroidBounds.grow(references[i].centroid);
+        }
+        return task;
+    }
+
+    // Sets the node's bounds and either makes it a leaf (returns false) or
+    // partitions its triangles into the two child tasks.
+    bool split(const Task& task, Task& left, Task& right) {
+        BvhNode& node = nodes[task.node];
+        node.boundsMin = task.bounds.lo;
+        node.boundsMax = task.bounds.hi;
+        size_t count = task.end - task.begin;
+        if (count < MIN_SPLIT_TRIANGLES) return makeLeaf(node, task);
+
+        // Bin along the axis where the centroids spread the most.
+        glm::vec3 extent = task.centroidBounds.hi - task.centroidBounds.lo;
+        int axis = extent.y > extent.x ? 1 : 0;
+        if (extent.z > extent[axis]) axis = 2;
+        if (extent[axis] <= 0.0f) {
+            if (count <= MAX_LEAF_TRIANGLES) return makeLeaf(node, task);
+            // All centroids coincide; halve the list to bound the leaf size.
+            size_t middle = task.begin + count / 2;
+            left = measure(0, task.begin, middle);
+            right = measure(0, middle, task.end);
+            return true;
+        }
+
+        float lo = task.centroidBounds.lo[axis];
+        float scale = SAH_BINS / extent[axis];
+        Bin bins[SAH_BINS];
+        for (size_t i = task.begin; i < task.end; ++i) {
+            const Reference& reference = references[i];
+            Bin& bin = bins[binOf(reference.centroid[axis], lo, scale)];
+            bin.box.grow(reference.box);
+            bin.centroids.grow(reference.centroid);
+            ++bin.count;
+        }
+        // Right-to-left sweep first, then the left side meets it.
+        Bin rightOf[SAH_BINS];
+        for (int b = SAH_BINS - 1; b > 0; --b) {
+            rightOf[b] = b + 1 < SAH_BINS ? rightOf[b + 1] : Bin();
+            rightOf[b].box.grow(bins[b].box);
+            rightOf[b].centroids.grow(bins[b].centroids);
+            rightOf[b].count += bins[b].count;
+        }
+        float parentArea = std::max(task.bounds.area(), std::numeric_limits<float>::min());
+        float bestCost = std::numeric_limits<float>::max();
+        int bestBin = 0;
+        Bin leftOf, bestLeft;
+        for (int b = 1; b < SAH_BINS; ++b) {
+            leftOf.box.grow(bins[b - 1].box);
+            leftOf.centroids.grow(bins[b - 1].centroids);
+            leftOf.count += bins[b - 1].count;
+            if (leftOf.count == 0 || rightOf[b].count == 0) continue;
+            float cost = TRAVERSAL_COST + (leftOf.box.area() * float(leftOf.count) +
+                                           rightOf[b].box.area() * float(rightOf[b].count)) / parentArea;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestBin = b;
+                bestLeft = leftOf;
+            }
+        }
+        if (count <= MAX_LEAF_TRIANGLES && float(count) <= bestCost) return makeLeaf(node, task);
+
+        auto middle = std::partition(references.begin() + task.begin, references.begin() + task.end,
+            [&](const Reference& reference) { return binOf(reference.centroid[axis], lo, scale) < bestBin; });
+        left.begin = task.begin;
+        left.end = size_t(middle - references.begin());
+        left.bounds = bestLeft.box;
+        left.centroidBounds = bestLeft.centroids;
+        right.begin = left.end;
+        right.end = task.end;
+        right.bounds = rightOf[bestBin].box;
+        right.centroidBounds = rightOf[bestBin].centroids;
+        return true;
+    }
+
+    static bool makeLeaf(BvhNode& node, const Task& task) {
+        node.first = static_cast<unsigned int>(task.begin);
+        node.triangleCount = static_cast<unsigned int>(task.end - task.begin);
+        return false;
+    }
+
+    static int binOf(float value, float lo, float scale) {
+        return std::min(SAH_BINS - 1, int((value - lo) * scale));
+    }
+
+    std::vector<BvhNode>& nodes;
+    std::vector<unsigned int>& triangles;
+    std::vector<Reference> references;
+};
+
+// Möller & Trumbore; both sides, hits in [0, maxDistance).
+bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b,
+                       const glm::vec3& c, float maxDistance, float& distance, float& u, float& v) {
+    glm::vec3 ab = b - a, ac = c - a;
+    glm::vec3 p = glm::cross(direction, ac);
+    float det = glm::dot(ab, p);
+    if (det == 0.0f) return false;
+    float inverse = 1.0f / det;
+    glm::vec3 s = origin - a;
+    u = glm::dot(s, p) * inverse;
+    if (u < 0.0f || u > 1.0f) return false;
+    glm::vec3 q = glm::cross(s, ab);
+    v = glm::dot(direction, q) * inverse;
+    if (v < 0.0f || u + v > 1.0f) return false;
+    distance = glm::dot(ac, q) * inverse;
+    return distance >= 0.0f && distance < maxDistance;
+}
+
+// Entry distance of the ray into the node's box, or infinity on a miss.
+float intersectNode(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+    float enter = 0.0f, leave = maxDistance;
+    for (int axis = 0; axis < 3; ++axis) {
+        float t0 = (node.boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+        float t1 = (node.boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+        if (t0 > t1) std::swap(t0, t1);
+        enter = std::max(enter, t0);
+        leave = std::min(leave, t1);
+    }
+    return enter <= leave ? enter : std::numeric_limits<float>::infinity();
+}
+
+}  // namespace
+
+
+size_t buildBvh(MeshData& meshData) {
+    BvhBuilder builder(meshData, meshData.bvh, meshData.bvhTriangles);
+    builder.build();
+    return meshData.bvh.size();
+}
+
+bool raycastMesh(const MeshData& meshData, const glm::vec3& origin, const glm::vec3& direction, MeshHit& hit,
+                 float maxDistance) {
+    const Vertex* vertices = meshData.vertexData();
+    const unsigned int* indices = meshData.indexData();
+    float nearest = maxDistance;
+    bool found = false;
+    auto test = [&](size_t t) {
+        float distance, u, v;
+        if (intersectTriangle(origin, direction, vertices[indices[3 * t]].Position, vertices[indices[3 * t + 1]].Position,
+                              vertices[indices[3 * t + 2]].Position, nearest, distance, u, v)) {
+            nearest = distance;
+            found = true;
+            hit.triangle = t;
+            hit.distance = distance;
+            hit.barycentric = glm::vec3(1.0f - u - v, u, v);
+        }
+    };
+
+    if (meshData.bvh.empty()) {
+        for (size_t t = 0; t < meshData.baseIndexCount() / 3; ++t) test(t);
+    }
+    else {
+        glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+        const std::vector<BvhNode>& nodes = meshData.bvh;
+        std::vector<unsigned int> stack;
+        stack.reserve(64);
+        if (intersectNode(nodes[0], origin, inverseDirection, nearest) < nearest) stack.push_back(0);
+        while (!stack.empty()) {
+            const BvhNode& node = nodes[stack.back()];
+            stack.pop_back();
+            if (node.triangleCount > 0) {
+                for (unsigned int i = node.first; i < node.first + node.triangleCount; ++i) test(meshData.bvhTriangles[i]);
+                continue;
+            }
+            // Visit the nearer child first so the far one is usually pruned.
+            float nearEntry = intersectNode(nodes[node.first], origin, inverseDirection, nearest);
+            float farEntry = intersectNode(nodes[node.first + 1], origin, inverseDirection, nearest);
+            unsigned int nearChild = node.first, farChild = node.first + 1;
+            if (farEntry < nearEntry) {
+                std::swap(nearEntry, farEntry);
+                std::swap(nearChild, farChild);
+            }
+            if (farEntry < nearest) stack.push_back(farChild);
+            if (nearEntry < nearest) stack.push_back(nearChild);
+        }
+    }
+    if (!found) return false;
+
+    int corner = 0;
+    for (int k = 1; k < 3; ++k) {
+        if (hit.barycentric[k] > hit.barycentric[corner]) corner = k;
+    }
+    hit.vertex = indices[3 * hit.triangle + corner];
+    hit.position = origin + hit.distance * direction;
+    return true;
+}
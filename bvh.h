@@ -0,0 +1,34 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cstddef>
+#include <limits>
+
+#include "mesh.h"
+
+// Builds a bounding volume hierarchy over the full-resolution triangles into
+// meshData.bvh and meshData.bvhTriangles, splitting each node where the
+// surface area heuristic is lowest over 16 bins along the axis its triangle
+// centroids spread most (Wald, "On fast Construction of SAH-based Bounding
+// Volume Hierarchies", 2007). Leaves hold up to 8 triangles. Run it after
+// every pass that reorders triangles; renumbering vertices afterwards is
+// fine. Returns the number of nodes.
+size_t buildBvh(MeshData& meshData);
+
+struct MeshHit {
+    size_t triangle = 0;          // full-resolution triangle, i.e. first index / 3
+    unsigned int vertex = 0;      // the triangle's corner closest to the hit
+    float distance = 0.0f;        // ray parameter of the hit
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 barycentric = glm::vec3(0.0f);  // weights of the three corners
+};
+
+// Nearest triangle hit by origin + t * direction for 0 <= t < maxDistance,
+// in mesh space; triangles count from both sides. Mapping the ray from
+// another space by an affine transform leaves t unchanged, so hits on
+// several meshes compare directly. Falls back to testing every triangle when
+// the mesh has no BVH.
+bool raycastMesh(const MeshData& meshData, const glm::vec3& origin, const glm::vec3& direction, MeshHit& hit,
+                 float maxDistance = std::numeric_limits<float>::infinity());
+
+#endif
@@ -0,0 +1,70 @@
+#include "file_list.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace {
+
+bool hasExtension(const std::string& name, const std::string& extension) {
+    if (name.size() < extension.size()) return false;
+    for (size_t i = 0; i < extension.size(); ++i) {
+        char a = static_cast<char>(std::tolower(static_cast<unsigned char>(name[name.size() - extension.size() + i])));
+        char b = static_cast<char>(std::tolower(static_cast<unsigned char>(extension[i])));
+        if (a != b) return false;
+    }
+    return true;
+}
+
+std::string joinPath(const std::string& directory, const std::string& name) {
+    if (directory.empty()) return name;
+    char last = directory[directory.size() - 1];
+    return (last == '/' || last == '\\') ? directory + name : directory + "/" + name;
+}
+
+}  // namespace
+
+
+bool isDirectory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFMT) == S_IFDIR;
+}
+
+std::vector<std::string> listFilesWithExtension(const std::string& directory, const std::string& extension) {
+    std::vector<std::string> files;
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA(joinPath(directory, "*").c_str(), &entry);
+    if (find != INVALID_HANDLE_VALUE) {
+        do {
+            if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && hasExtension(entry.cFileName, extension)) {
+                files.push_back(joinPath(directory, entry.cFileName));
+            }
+        } while (FindNextFileA(find, &entry));
+        FindClose(find);
+    }
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (dir) {
+        while (dirent* entry = readdir(dir)) {
+            std::string path = joinPath(directory, entry->d_name);
+            struct stat st;
+            if (hasExtension(entry->d_name, extension) && stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG) {
+                files.push_back(path);
+            }
+        }
+        closedir(dir);
+    }
+#endif
+    std::sort(files.begin(), files.end());
+    return files;
+}
@@ -0,0 +1,13 @@
+#ifndef FILE_LIST_H
+#define FILE_LIST_H
+
+#include <string>
+#include <vector>
+
+bool isDirectory(const std::string& path);
+
+// Regular files in directory whose names end in extension (case-insensitive),
+// sorted by name. Not recursive.
+std::vector<std::string> listFilesWithExtension(const std::string& directory, const std::string& extension);
+
+#endif
@@ -0,0 +1,656 @@
+#include "gltf_loader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+#include "normal_gen.h"
+#include "submesh.h"
+
+namespace {
+
+const uint32_t GLB_MAGIC = 0x46546C67;       // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;  // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;   // "BIN\0"
+
+const int COMPONENT_UNSIGNED_BYTE = 5121;
+const int COMPONENT_UNSIGNED_SHORT = 5123;
+const int COMPONENT_UNSIGNED_INT = 5125;
+const int COMPONENT_FLOAT = 5126;
+const int MODE_TRIANGLES = 4;
+
+// Just enough JSON for the glTF header: a DOM of objects, arrays, strings,
+// numbers, booleans and null.
+struct JsonValue {
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+    Type type = NUL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string text;
+    std::vector<JsonValue> items;  // array elements, or object member values
+    std::vector<std::string> keys; // object member names, parallel to items
+
+    const JsonValue& operator[](const char* key) const {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (keys[i] == key) return items[i];
+        }
+        return null();
+    }
+    const JsonValue& operator[](size_t index) const {
+        return (type == ARRAY && index < items.size()) ? items[index] : null();
+    }
+    size_t size() const { return type == ARRAY ? items.size() : 0; }
+    bool has(const char* key) const { return (*this)[key].type != NUL; }
+    int asInt(int fallback) const { return type == NUMBER ? static_cast<int>(number) : fallback; }
+    double asNumber(double fallback) const { return type == NUMBER ? number : fallback; }
+
+    static const JsonValue& null() {
+        static const JsonValue value;
+        return value;
+    }
+};
+
+class JsonParser {
+public:
+    JsonParser(const char* begin, const char* end) : p(begin), end(end) {}
+
+    bool parse(JsonValue& value) {
+        bool ok = parseValue(value, 0);
+        skipSpace();
+        return ok && p == end;
+    }
+
+private:
+    static const int MAX_DEPTH = 128;
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+    }
+
+    bool literal(const char* word) {
+        size_t length = std::strlen(word);
+        if (size_t(end - p) < length || std::memcmp(p, word, length) != 0) return false;
+        p += length;
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned int code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        }
+        else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool hex4(unsigned int& code) {
+        if (end - p < 4) return false;
+        code = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = *p++;
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= unsigned(c - '0');
+            else if (c >= 'a' && c <= 'f') code |= unsigned(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') code |= unsigned(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (p >= end || *p != '"') return false;
+        ++p;
+        while (p < end && *p != '"') {
+            char c = *p++;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (p >= end) return false;
+            char escape = *p++;
+            switch (escape) {
+            case '"': case '\\': case '/': out += escape; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned int code;
+                if (!hex4(code)) return false;
+                if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    p += 2;
+                    unsigned int low;
+                    if (!hex4(low)) return false;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default: return false;
+            }
+        }
+        if (p >= end) return false;
+        ++p;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth) {
+        if (depth > MAX_DEPTH) return false;
+        skipSpace();
+        if (p >= end) return false;
+        char c = *p;
+        if (c == '{') {
+            ++p;
+            value.type = JsonValue::OBJECT;
+            skipSpace();
+            if (p < end && *p == '}') { ++p; return true; }
+            for (;;) {
+                skipSpace();
+                value.keys.push_back(std::string());
+                if (!parseString(value.keys.back())) return false;
+                skipSpace();
+                if (p >= end || *p++ != ':') return false;
+                value.items.push_back(JsonValue());
+                if (!parseValue(value.items.back(), depth + 1)) return false;
+                skipSpace();
+                if (p < end && *p == ',') { ++p; continue; }
+                if (p < end && *p == '}') { ++p; return true; }
+                return false;
+            }
+        }
+        if (c == '[') {
+            ++p;
+            value.type = JsonValue::ARRAY;
+            skipSpace();
+            if (p < end && *p == ']') { ++p; return true; }
+            for (;;) {
+                value.items.push_back(JsonValue());
+                if (!parseValue(value.items.back(), depth + 1)) return false;
+                skipSpace();
+                if (p < end && *p == ',') { ++p; continue; }
+                if (p < end && *p == ']') { ++p; return true; }
+                return false;
+            }
+        }
+        if (c == '"') {
+            value.type = JsonValue::STRING;
+            return parseString(value.text);
+        }
+        if (literal("true")) { value.type = JsonValue::BOOLEAN; value.boolean = true; return true; }
+        if (literal("false")) { value.type = JsonValue::BOOLEAN; return true; }
+        if (literal("null")) return true;
+
+        // strtod needs a terminated string; numbers are short.
+        const char* start = p;
+        while (p < end && (std::strchr("+-.eE", *p) || (*p >= '0' && *p <= '9'))) ++p;
+        if (p == start || p - start > 64) return false;
+        std::string number(start, p);
+        char* parsedEnd = nullptr;
+        value.number = std::strtod(number.c_str(), &parsedEnd);
+        value.type = JsonValue::NUMBER;
+        return parsedEnd == number.c_str() + number.size();
+    }
+
+    const char* p;
+    const char* end;
+};
+
+uint32_t readU32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// A typed, bounds-checked window onto an accessor's elements in the BIN chunk.
+struct AccessorView {
+    const unsigned char* data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    int componentType = 0;
+    int components = 0;
+    int bufferView = -1;
+    size_t byteOffset = 0;  // within the buffer view
+};
+
+struct GlbFile {
+    JsonValue json;
+    const unsigned char* bin = nullptr;
+    size_t binSize = 0;
+};
+
+size_t componentSize(int componentType) {
+    switch (componentType) {
+    case 5120: case 5121: return 1;
+    case 5122: case 5123: return 2;
+    case 5125: case 5126: return 4;
+    }
+    return 0;
+}
+
+int componentCount(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0;
+}
+
+bool resolveAccessor(const GlbFile& glb, int index, AccessorView& view, std::string& error) {
+    const JsonValue& accessor = glb.json["accessors"][size_t(index)];
+    if (index < 0 || accessor.type != JsonValue::OBJECT) {
+        error = "missing accessor " + std::to_string(index);
+        return false;
+    }
+    if (accessor.has("sparse")) {
+        error = "sparse accessors are not supported";
+        return false;
+    }
+    view.bufferView = accessor["bufferView"].asInt(-1);
+    const JsonValue& bufferView = glb.json["bufferViews"][size_t(view.bufferView)];
+    if (view.bufferView < 0 || bufferView.type != JsonValue::OBJECT) {
+        error = "accessors without a buffer view are not supported";
+        return false;
+    }
+    if (bufferView["buffer"].asInt(0) != 0 || glb.json["buffers"][size_t(0)].has("uri")) {
+        error = "only the embedded GLB buffer is supported";
+        return false;
+    }
+
+    view.componentType = accessor["componentType"].asInt(0);
+    view.components = componentCount(accessor["type"].text);
+    size_t elementSize = componentSize(view.componentType) * size_t(view.components);
+    if (elementSize == 0) {
+        error = "unsupported accessor type";
+        return false;
+    }
+    double count = accessor["count"].asNumber(-1.0);
+    double viewOffset = bufferView["byteOffset"].asNumber(0.0);
+    double viewLength = bufferView["byteLength"].asNumber(-1.0);
+    double accessorOffset = accessor["byteOffset"].asNumber(0.0);
+    double stride = bufferView["byteStride"].asNumber(double(elementSize));
+    if (count < 0 || viewOffset < 0 || viewLength < 0 || accessorOffset < 0 || stride < double(elementSize) ||
+        viewOffset + viewLength > double(glb.binSize) ||
+        (count > 0 && accessorOffset + stride * (count - 1) + double(elementSize) > viewLength)) {
+        error = "accessor " + std::to_string(index) + " is out of bounds";
+        return false;
+    }
+    view.count = static_cast<size_t>(count);
+    view.stride = static_cast<size_t>(stride);
+    view.byteOffset = static_cast<size_t>(accessorOffset);
+    view.data = glb.bin + static_cast<size_t>(viewOffset) + view.byteOffset;
+    return true;
+}
+
+bool isFloat3(const AccessorView& view) {
+    return view.componentType == COMPONENT_FLOAT && view.components == 3;
+}
+
+glm::vec3 readFloat3(const AccessorView& view, size_t i) {
+    float xyz[3];
+    std::memcpy(xyz, view.data + i * view.stride, sizeof(xyz));
+    return glm::vec3(xyz[0], xyz[1], xyz[2]);
+}
+
+uint32_t readIndex(const AccessorView& view, size_t i) {
+    const unsigned char* p = view.data + i * view.stride;
+    if (view.componentType == COMPONENT_UNSIGNED_BYTE) return *p;
+    if (view.componentType == COMPONENT_UNSIGNED_SHORT) {
+        uint16_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    return readU32(p);
+}
+
+glm::mat4 nodeTransform(const JsonValue& node, bool& identity) {
+    glm::mat4 local(1.0f);
+    identity = true;
+    const JsonValue& matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        for (int column = 0; column < 4; ++column) {
+            for (int row = 0; row < 4; ++row) {
+                float value = static_cast<float>(matrix[size_t(4 * column + row)].asNumber(0.0));
+                local[column][row] = value;
+                if (value != (column == row ? 1.0f : 0.0f)) identity = false;
+            }
+        }
+        return local;
+    }
+
+    // T * R * S, with the rotation quaternion stored as (x, y, z, w).
+    const JsonValue& t = node["translation"];
+    const JsonValue& r = node["rotation"];
+    const JsonValue& s = node["scale"];
+    float x = 0, y = 0, z = 0, w = 1;
+    if (r.size() == 4) {
+        x = float(r[size_t(0)].asNumber(0)); y = float(r[size_t(1)].asNumber(0));
+        z = float(r[size_t(2)].asNumber(0)); w = float(r[size_t(3)].asNumber(1));
+    }
+    glm::vec3 scale(1.0f);
+    if (s.size() == 3) scale = glm::vec3(float(s[size_t(0)].asNumber(1)), float(s[size_t(1)].asNumber(1)), float(s[size_t(2)].asNumber(1)));
+    local[0][0] = (1 - 2 * (y * y + z * z)) * scale.x;
+    local[0][1] = (2 * (x * y + z * w)) * scale.x;
+    local[0][2] = (2 * (x * z - y * w)) * scale.x;
+    local[1][0] = (2 * (x * y - z * w)) * scale.y;
+    local[1][1] = (1 - 2 * (x * x + z * z)) * scale.y;
+    local[1][2] = (2 * (y * z + x * w)) * scale.y;
+    local[2][0] = (2 * (x * z + y * w)) * scale.z;
+    local[2][1] = (2 * (y * z - x * w)) * scale.z;
+    local[2][2] = (1 - 2 * (x * x + y * y)) * scale.z;
+    if (t.size() == 3) {
+        local[3][0] = float(t[size_t(0)].asNumber(0));
+        local[3][1] = float(t[size_t(1)].asNumber(0));
+        local[3][2] = float(t[size_t(2)].asNumber(0));
+    }
+    identity = t.size() != 3 && r.size() != 4 && s.size() != 3;
+    return local;
+}
+
+struct PrimitiveInstance {
+    const JsonValue* primitive;
+    glm::mat4 world;
+    bool identity;
+};
+
+void collectInstances(const GlbFile& glb, int nodeIndex, const glm::mat4& parent, bool parentIdentity, int depth,
+                      std::vector<PrimitiveInstance>& instances) {
+    const JsonValue& node = glb.json["nodes"][size_t(nodeIndex)];
+    if (nodeIndex < 0 || node.type != JsonValue::OBJECT || depth > 64) return;
+    bool localIdentity;
+    glm::mat4 local = nodeTransform(node, localIdentity);
+    glm::mat4 world = localIdentity ? parent : (parentIdentity ? local : parent * local);
+    bool identity = parentIdentity && localIdentity;
+
+    const JsonValue& primitives = glb.json["meshes"][size_t(node["mesh"].asInt(-1))]["primitives"];
+    for (size_t p = 0; p < primitives.size(); ++p) {
+        PrimitiveInstance instance = { &primitives[p], world, identity };
+        instances.push_back(instance);
+    }
+    const JsonValue& children = node["children"];
+    for (size_t c = 0; c < children.size(); ++c) {
+        collectInstances(glb, children[c].asInt(-1), world, identity, depth + 1, instances);
+    }
+}
+
+bool openGlb(const MappedFile& file, GlbFile& glb, std::string& error) {
+    const unsigned char* data = file.data();
+    size_t size = file.size();
+    if (size < 20 || readU32(data) != GLB_MAGIC || readU32(data + 4) != 2) {
+        error = "not a glTF 2.0 binary file";
+        return false;
+    }
+    size_t length = std::min<size_t>(readU32(data + 8), size);
+    size_t pos = 12;
+    bool haveJson = false;
+    while (pos + 8 <= length) {
+        size_t chunkLength = readU32(data + pos);
+        uint32_t chunkType = readU32(data + pos + 4);
+        pos += 8;
+        if (chunkLength > length - pos) {
+            error = "truncated chunk";
+            return false;
+        }
+        if (chunkType == GLB_CHUNK_JSON && !haveJson) {
+            const char* text = reinterpret_cast<const char*>(data + pos);
+            if (!JsonParser(text, text + chunkLength).parse(glb.json) || glb.json.type != JsonValue::OBJECT) {
+                error = "malformed JSON chunk";
+                return false;
+            }
+            haveJson = true;
+        }
+        else if (chunkType == GLB_CHUNK_BIN && !glb.bin) {
+            glb.bin = data + pos;
+            glb.binSize = chunkLength;
+        }
+        pos += (chunkLength + 3) & ~size_t(3);
+    }
+    if (!haveJson) {
+        error = "missing JSON chunk";
+        return false;
+    }
+    const JsonValue& required = glb.json["extensionsRequired"];
+    if (required.size() > 0) {
+        error = "required extension " + required[size_t(0)].text + " is not supported";
+        return false;
+    }
+    return true;
+}
+
+// The single-primitive fast path: both arrays used in place if the layout
+// allows it.
+void mapPrimitive(const AccessorView& positions, const AccessorView* normals, const AccessorView* indices,
+                  MeshData& meshData) {
+    static_assert(sizeof(Vertex) == 6 * sizeof(float), "Vertex must be two tightly packed vec3s");
+    if (normals && isFloat3(positions) && isFloat3(*normals) &&
+        positions.stride == sizeof(Vertex) && normals->bufferView == positions.bufferView &&
+        normals->byteOffset == positions.byteOffset + Vertex::offsetOf<NormalAttribute>() && normals->count == positions.count &&
+        reinterpret_cast<uintptr_t>(positions.data) % alignof(Vertex) == 0) {
+        meshData.mappedVertices = reinterpret_cast<const Vertex*>(positions.data);
+        meshData.mappedVertexCount = positions.count;
+    }
+    // Without normals the indices have to stay in a vector for generateNormals().
+    if (normals && indices && indices->componentType == COMPONENT_UNSIGNED_INT && indices->components == 1 &&
+        indices->stride == sizeof(unsigned int) && indices->count % 3 == 0 &&
+        reinterpret_cast<uintptr_t>(indices->data) % alignof(unsigned int) == 0) {
+        // An out-of-range index would make the GPU read past the VBO.
+        const unsigned int* data = reinterpret_cast<const unsigned int*>(indices->data);
+        unsigned int largest = 0;
+        for (size_t i = 0; i < indices->count; ++i) largest = std::max(largest, data[i]);
+        if (indices->count == 0 || largest < positions.count) {
+            meshData.mappedIndices = data;
+            meshData.mappedIndexCount = indices->count;
+        }
+    }
+}
+
+}  // namespace
+
+
+bool loadGlbModel(const std::string& filepath, MeshData& meshData, const MeshLoadOptions& options) {
+    if (options.progress) options.progress->stage.store(MeshLoadProgress::PARSING);
+    meshData.clear();
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(filepath)) {
+        std::cerr << "glTF Error: Cannot open file [" << filepath << "]" << std::endl;
+        return false;
+    }
+    GlbFile glb;
+    std::string error;
+    if (!openGlb(*file, glb, error)) {
+        std::cerr << "glTF Error: " << filepath << ": " << error << std::endl;
+        return false;
+    }
+
+    std::vector<PrimitiveInstance> instances;
+    const JsonValue& scenes = glb.json["scenes"];
+    if (scenes.size() > 0) {
+        const JsonValue& roots = scenes[size_t(glb.json["scene"].asInt(0))]["nodes"];
+        for (size_t i = 0; i < roots.size(); ++i) {
+            collectInstances(glb, roots[i].asInt(-1), glm::mat4(1.0f), true, 0, instances);
+        }
+    }
+    else {
+        // No scene: show every mesh once, untransformed.
+        const JsonValue& meshes = glb.json["meshes"];
+        for (size_t m = 0; m < meshes.size(); ++m) {
+            const JsonValue& primitives = meshes[m]["primitives"];
+            for (size_t p = 0; p < primitives.size(); ++p) {
+                PrimitiveInstance instance = { &primitives[p], glm::mat4(1.0f), true };
+                instances.push_back(instance);
+            }
+        }
+    }
+
+    const JsonValue& materials = glb.json["materials"];
+    meshData.materials.resize(materials.size());
+    for (size_t m = 0; m < materials.size(); ++m) {
+        const JsonValue& color = materials[m]["pbrMetallicRoughness"]["baseColorFactor"];
+        if (color.size() >= 3) {
+            meshData.materials[m].diffuse = glm::vec3(float(color[size_t(0)].asNumber(1)),
+                                                      float(color[size_t(1)].asNumber(1)),
+                                                      float(color[size_t(2)].asNumber(1)));
+        }
+        else {
+            meshData.materials[m].diffuse = glm::vec3(1.0f);
+        }
+    }
+
+    // Resolve every accessor first so errors surface before any copying.
+    struct ResolvedPrimitive {
+        AccessorView positions, normals, indices;
+        bool hasNormals, hasIndices;
+        int materialId;
+        const PrimitiveInstance* instance;
+    };
+    std::vector<ResolvedPrimitive> resolved;
+    size_t vertexTotal = 0, indexTotal = 0;
+    for (const PrimitiveInstance& instance : instances) {
+        const JsonValue& primitive = *instance.primitive;
+        if (primitive["mode"].asInt(MODE_TRIANGLES) != MODE_TRIANGLES) {
+            std::cout << "glTF Warning: skipping a non-triangle primitive in " << filepath << std::endl;
+            continue;
+        }
+        ResolvedPrimitive entry;
+        const JsonValue& attributes = primitive["attributes"];
+        if (!resolveAccessor(glb, attributes["POSITION"].asInt(-1), entry.positions, error)) break;
+        if (!isFloat3(entry.positions)) {
+            error = "POSITION must be float3 (quantized meshes are not supported)";
+            break;
+        }
+        entry.hasNormals = attributes.has("NORMAL");
+        if (entry.hasNormals && !resolveAccessor(glb, attributes["NORMAL"].asInt(-1), entry.normals, error)) break;
+        if (entry.hasNormals && (!isFloat3(entry.normals) || entry.normals.count != entry.positions.count)) {
+            error = "NORMAL must be float3 with one entry per position";
+            break;
+        }
+        entry.hasIndices = primitive.has("indices");
+        if (entry.hasIndices && !resolveAccessor(glb, primitive["indices"].asInt(-1), entry.indices, error)) break;
+        if (entry.hasIndices && (entry.indices.components != 1 || componentSize(entry.indices.componentType) == 0 ||
+                                 entry.indices.componentType == COMPONENT_FLOAT)) {
+            error = "indices must be unsigned integers";
+            break;
+        }
+        int materialId = primitive["material"].asInt(-1);
+        entry.materialId = (materialId >= 0 && size_t(materialId) < meshData.materials.size()) ? materialId : -1;
+        entry.instance = &instance;
+        vertexTotal += entry.positions.count;
+        indexTotal += entry.hasIndices ? entry.indices.count : entry.positions.count;
+        resolved.push_back(entry);
+    }
+    if (!error.empty()) {
+        std::cerr << "glTF Error: " << filepath << ": " << error << std::endl;
+        return false;
+    }
+
+    if (resolved.size() == 1 && resolved[0].instance->identity) {
+        const ResolvedPrimitive& only = resolved[0];
+        mapPrimitive(only.positions, only.hasNormals ? &only.normals : nullptr,
+                     only.hasIndices ? &only.indices : nullptr, meshData);
+    }
+
+    std::vector<unsigned int> triangleParts;
+    std::vector<int> triangleMaterials;
+    if (!meshData.mappedVertices) meshData.vertices.reserve(vertexTotal);
+    if (!meshData.mappedIndices) {
+        meshData.indices.reserve(indexTotal);
+        triangleParts.reserve(indexTotal / 3);
+        triangleMaterials.reserve(indexTotal / 3);
+    }
+
+    for (size_t part = 0; part < resolved.size(); ++part) {
+        const ResolvedPrimitive& entry = resolved[part];
+        size_t baseVertex = meshData.vertices.size();
+        if (!meshData.mappedVertices) {
+            const glm::mat4& world = entry.instance->world;
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+            meshData.vertices.resize(baseVertex + entry.positions.count);
+            for (size_t i = 0; i < entry.positions.count; ++i) {
+                Vertex& vertex = meshData.vertices[baseVertex + i];
+                vertex.Position = readFloat3(entry.positions, i);
+                vertex.Normal = entry.hasNormals ? readFloat3(entry.normals, i) : glm::vec3(0.0f);
+                if (!entry.instance->identity) {
+                    glm::vec4 moved = world * glm::vec4(vertex.Position, 1.0f);
+                    vertex.Position = glm::vec3(moved.x, moved.y, moved.z);
+                    if (entry.hasNormals && vertex.Normal != glm::vec3(0.0f)) {
+                        vertex.Normal = glm::normalize(normalMatrix * vertex.Normal);
+                    }
+                }
+            }
+        }
+        if (meshData.mappedIndices) continue;
+
+        size_t cornerCount = entry.hasIndices ? entry.indices.count : entry.positions.count;
+        cornerCount -= cornerCount % 3;
+        // A mirroring transform turns the triangles inside out; swapping two
+        // corners restores counter-clockwise front faces.
+        bool mirrored = glm::determinant(glm::mat3(entry.instance->world)) < 0.0f;
+        for (size_t i = 0; i < cornerCount; ++i) {
+            size_t corner = i;
+            if (mirrored && i % 3 != 0) corner = (i % 3 == 1) ? i + 1 : i - 1;
+            uint32_t index = entry.hasIndices ? readIndex(entry.indices, corner) : uint32_t(corner);
+            if (index >= entry.positions.count) {
+                std::cerr << "glTF Error: " << filepath << ": index out of range" << std::endl;
+                meshData.clear();
+                return false;
+            }
+            meshData.indices.push_back(static_cast<unsigned int>(baseVertex + index));
+        }
+        triangleParts.insert(triangleParts.end(), cornerCount / 3, static_cast<unsigned int>(part));
+        triangleMaterials.insert(triangleMaterials.end(), cornerCount / 3, entry.materialId);
+    }
+
+    if (meshData.mappedVertices || meshData.mappedIndices) meshData.mapping = file;
+
+    if (!meshData.mappedVertices) {
+        generateNormals(meshData, options.normals);
+    }
+    if (meshData.mappedIndices) {
+        // Mapped indices can't be reordered; there is only one primitive.
+        Submesh submesh;
+        submesh.indexCount = static_cast<unsigned int>(meshData.mappedIndexCount);
+        submesh.materialId = resolved[0].materialId;
+        meshData.computeBounds();
+        submesh.boundsMin = meshData.boundsMin;
+        submesh.boundsMax = meshData.boundsMax;
+        if (submesh.indexCount > 0) meshData.submeshes.push_back(submesh);
+    }
+    else if (meshData.mappedVertices) {
+        // buildSubmeshes() reads positions from the vector; map them over.
+        std::vector<Vertex> view(meshData.mappedVertices, meshData.mappedVertices + meshData.mappedVertexCount);
+        std::swap(meshData.vertices, view);
+        buildSubmeshes(meshData, triangleParts, triangleMaterials);
+        std::swap(meshData.vertices, view);
+    }
+    else {
+        buildSubmeshes(meshData, triangleParts, triangleMaterials);
+    }
+    meshData.computeBounds();
+
+    if (meshData.vertexCount() == 0 || meshData.indexCount() == 0) {
+        std::cerr << "Warning: Loaded glTF file resulted in empty mesh data." << std::endl;
+    }
+    if (options.progress) options.progress->stage.store(MeshLoadProgress::DONE);
+    return true;
+}
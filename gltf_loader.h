@@ -0,0 +1,29 @@
+#ifndef GLTF_LOADER_H
+#define GLTF_LOADER_H
+
+#include <string>
+
+#include "mesh.h"
+
+// Loads the triangle primitives of a binary glTF 2.0 file (.glb) into
+// MeshData, one submesh per primitive instance in the default scene, with
+// node transforms applied and baseColorFactor as the material colour.
+//
+// The file is memory-mapped and nothing is parsed beyond the JSON header.
+// When the whole scene is a single untransformed primitive whose POSITION
+// and NORMAL accessors are float3 interleaved with Vertex's layout (stride
+// 24, normal at +12), mappedVertices points straight into the BIN chunk; a
+// lone UNSIGNED_INT index accessor likewise becomes mappedIndices if the
+// primitive has normals. Anything else is gathered with one strided copy per
+// attribute (see MeshData::mappedVertices). Node transforms that mirror
+// (negative determinant) get their triangle winding reversed. TEXCOORD_0 is
+// not part of Vertex and is ignored; missing normals are generated as for
+// OBJ.
+//
+// Quantized, sparse or Draco/meshopt-compressed accessors are reported as
+// errors. This only reads the file; loadModel (mesh.h) runs the optimizations
+// and caches their result like for OBJ.
+bool loadGlbModel(const std::string& filepath, MeshData& meshData,
+                  const MeshLoadOptions& options = MeshLoadOptions());
+
+#endif
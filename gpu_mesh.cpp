@@ -0,0 +1,336 @@
+#include "gpu_mesh.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "vertex_format_gl.h"
+#include "vertex_quantize.h"
+
+
+namespace {
+
+// Entries of the VBO: the vertex array, or its 16-bit chunk layout.
+size_t gpuVertexCount(const MeshData& mesh) {
+    return mesh.chunkVertices.empty() ? mesh.vertexCount() : mesh.chunkVertices.size();
+}
+
+}  // namespace
+
+void uploadMesh(const MeshData& mesh, GpuMesh& gpuMesh, bool quantize) {
+    MeshUploadStream stream(mesh, gpuMesh, quantize);
+    stream.advance(std::numeric_limits<size_t>::max());
+}
+
+MeshUploadStream::MeshUploadStream(const MeshData& mesh, GpuMesh& gpuMesh, bool quantize)
+    : mesh(mesh), gpuMesh(gpuMesh), quantize(quantize), level(mesh.lods.size()) {
+    if (gpuMesh.VAO == 0) {
+        glGenVertexArrays(1, &gpuMesh.VAO);
+        glGenBuffers(1, &gpuMesh.VBO);
+        glGenBuffers(1, &gpuMesh.EBO);
+    }
+
+    glBindVertexArray(gpuMesh.VAO);
+
+    // Full-size storage now, contents in advance().
+    glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
+    if (quantize) {
+        gpuMesh.positionTransform = quantizationTransform(mesh);
+        glBufferData(GL_ARRAY_BUFFER, gpuVertexCount(mesh) * sizeof(QuantizedVertex), nullptr, GL_STATIC_DRAW);
+        setVertexAttributes<QuantizedVertex>();
+    }
+    else {
+        gpuMesh.positionTransform = glm::mat4(1.0f);
+        glBufferData(GL_ARRAY_BUFFER, gpuVertexCount(mesh) * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+        setVertexAttributes<Vertex>();
+    }
+    gpuMesh.octahedralNormals = quantize;
+
+    if (!mesh.edges.empty()) {
+        if (gpuMesh.outlineVAO == 0) {
+            glGenVertexArrays(1, &gpuMesh.outlineVAO);
+            glGenBuffers(1, &gpuMesh.outlineEBO);
+        }
+        glBindVertexArray(gpuMesh.outlineVAO);
+        if (quantize) setVertexAttributes<QuantizedVertex>();
+        else setVertexAttributes<Vertex>();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.outlineEBO);
+        glBindVertexArray(gpuMesh.VAO);
+    }
+    // Edges name mesh vertices; point each at its first entry in the chunk
+    // layout.
+    gpuMesh.outlineVertices.clear();
+    if (!mesh.edges.empty() && !mesh.chunkVertices.empty()) {
+        gpuMesh.outlineVertices.resize(mesh.vertexCount());
+        for (size_t slot = mesh.chunkVertices.size(); slot-- > 0;) {
+            gpuMesh.outlineVertices[mesh.chunkVertices[slot]] = static_cast<unsigned int>(slot);
+        }
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.EBO);
+    if (!mesh.shortIndices.empty()) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.shortIndices.size() * sizeof(uint16_t), nullptr, GL_STATIC_DRAW);
+        gpuMesh.indexType = GL_UNSIGNED_SHORT;
+        gpuMesh.indexChunks = mesh.indexChunks;
+    }
+    else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexCount() * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+        gpuMesh.indexType = GL_UNSIGNED_INT;
+        gpuMesh.indexChunks.clear();
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    gpuMesh.indexCount = mesh.baseIndexCount();
+    gpuMesh.submeshes = mesh.submeshes;
+    gpuMesh.materials = mesh.materials;
+    gpuMesh.lods = mesh.lods;
+    gpuMesh.lodSubmeshes = mesh.lodSubmeshes;
+    gpuMesh.meshlets = mesh.meshlets;
+    gpuMesh.sphereCenter = 0.5f * (mesh.boundsMin + mesh.boundsMax);
+    gpuMesh.sphereRadius = 0.5f * glm::length(mesh.boundsMax - mesh.boundsMin);
+    gpuMesh.finestLevel = mesh.lods.size() + 1;
+}
+
+size_t MeshUploadStream::advance(size_t byteBudget) {
+    size_t uploaded = 0;
+    size_t vertexCount = gpuVertexCount(mesh);
+    if (verticesUploaded < vertexCount) {
+        size_t vertexSize = quantize ? sizeof(QuantizedVertex) : sizeof(Vertex);
+        size_t count = std::min(vertexCount - verticesUploaded, std::max<size_t>(1, byteBudget / vertexSize));
+        const unsigned int* vertexIds = mesh.chunkVertices.empty() ? nullptr : mesh.chunkVertices.data();
+        const void* data = mesh.vertexData() + verticesUploaded;
+        if (quantize) {
+            quantized.resize(count);
+            quantizeVertexRange(mesh, gpuMesh.positionTransform, verticesUploaded, count, quantized.data(), vertexIds);
+            data = quantized.data();
+        }
+        else if (vertexIds) {
+            gathered.resize(count);
+            for (size_t v = 0; v < count; ++v) gathered[v] = mesh.vertexData()[vertexIds[verticesUploaded + v]];
+            data = gathered.data();
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, verticesUploaded * vertexSize, count * vertexSize, data);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        verticesUploaded += count;
+        uploaded += count * vertexSize;
+    }
+
+    // No level is drawable before every vertex is in.
+    if (verticesUploaded < vertexCount || finished) return uploaded;
+    bool shortIndices = !mesh.shortIndices.empty();
+    size_t indexSize = shortIndices ? sizeof(uint16_t) : sizeof(unsigned int);
+    const unsigned char* indexBytes = shortIndices ? reinterpret_cast<const unsigned char*>(mesh.shortIndices.data())
+                                                   : reinterpret_cast<const unsigned char*>(mesh.indexData());
+    // The EBO is VAO state; bind it through the VAO it belongs to.
+    glBindVertexArray(gpuMesh.VAO);
+    while (!finished && (uploaded < byteBudget || uploaded == 0)) {
+        size_t first = level > 0 ? mesh.lods[level - 1].indexOffset : 0;
+        size_t count = level > 0 ? mesh.lods[level - 1].indexCount : mesh.baseIndexCount();
+        size_t remaining = count - levelUploaded;
+        size_t piece = std::min(remaining, std::max<size_t>(1, (byteBudget - std::min(byteBudget, uploaded)) / indexSize));
+        if (piece > 0) {
+            size_t offset = (first + levelUploaded) * indexSize;
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, piece * indexSize, indexBytes + offset);
+            levelUploaded += piece;
+            uploaded += piece * indexSize;
+        }
+        if (levelUploaded == count) {
+            gpuMesh.finestLevel = level;
+            if (level == 0) finished = true;
+            else --level;
+            levelUploaded = 0;
+        }
+    }
+    glBindVertexArray(0);
+    return uploaded;
+}
+
+namespace {
+
+// Draw lists for one glMultiDrawElements[BaseVertex]; reused between calls,
+// only ever touched from the GL thread.
+struct MultiDraw {
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    std::vector<GLint> baseVertices;
+
+    void clear() {
+        counts.clear();
+        offsets.clear();
+        baseVertices.clear();
+    }
+
+    // Adds indices [first, first + count), split where 16-bit chunks end.
+    void add(const GpuMesh& gpuMesh, size_t first, size_t count) {
+        if (gpuMesh.indexChunks.empty()) {
+            counts.push_back(static_cast<GLsizei>(count));
+            offsets.push_back(reinterpret_cast<const void*>(first * sizeof(unsigned int)));
+            return;
+        }
+        const std::vector<IndexChunk>& chunks = gpuMesh.indexChunks;
+        auto chunk = std::upper_bound(chunks.begin(), chunks.end(), first,
+            [](size_t index, const IndexChunk& c) { return index < c.indexOffset; }) - 1;
+        size_t end = first + count;
+        for (; first < end; ++chunk) {
+            size_t pieceEnd = std::min(end, size_t(chunk->indexOffset) + chunk->indexCount);
+            counts.push_back(static_cast<GLsizei>(pieceEnd - first));
+            offsets.push_back(reinterpret_cast<const void*>(first * sizeof(uint16_t)));
+            baseVertices.push_back(static_cast<GLint>(chunk->baseVertex));
+            first = pieceEnd;
+        }
+    }
+
+    void draw(const GpuMesh& gpuMesh) const {
+        if (gpuMesh.indexChunks.empty()) {
+            glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(),
+                                static_cast<GLsizei>(counts.size()));
+        }
+        else {
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_SHORT, offsets.data(),
+                                          static_cast<GLsizei>(counts.size()), baseVertices.data());
+        }
+    }
+};
+
+// Draws indices [first, first + count) with the current program.
+void drawRange(const GpuMesh& gpuMesh, size_t first, size_t count) {
+    static MultiDraw batch;
+    batch.clear();
+    batch.add(gpuMesh, first, count);
+    glBindVertexArray(gpuMesh.VAO);
+    batch.draw(gpuMesh);
+    glBindVertexArray(0);
+}
+
+}  // namespace
+
+void drawMesh(const GpuMesh& gpuMesh) {
+    drawRange(gpuMesh, 0, gpuMesh.indexCount);
+}
+
+size_t drawSubmeshes(const GpuMesh& gpuMesh, const std::function<void(int)>& beginMaterial,
+                     const std::function<bool(const Submesh&)>& isVisible, size_t lod,
+                     const std::function<bool(const Meshlet&)>& isMeshletVisible) {
+    const MeshLod* level = lod > 0 && lod <= gpuMesh.lods.size() ? &gpuMesh.lods[lod - 1] : nullptr;
+    // A mesh without submeshes is one part under material -1 that is never
+    // culled as a whole.
+    Submesh whole;
+    whole.indexOffset = level ? level->indexOffset : 0;
+    whole.indexCount = static_cast<unsigned int>(level ? level->indexCount : gpuMesh.indexCount);
+    bool hasParts = !gpuMesh.submeshes.empty();
+    const Submesh* parts = !hasParts ? &whole : level ? &gpuMesh.lodSubmeshes[level->submeshOffset] : gpuMesh.submeshes.data();
+    size_t partCount = !hasParts ? 1 : level ? level->submeshCount : gpuMesh.submeshes.size();
+    // Meshlets only cover the full-resolution triangles.
+    bool cullMeshlets = !level && isMeshletVisible && !gpuMesh.meshlets.empty();
+    const Meshlet* meshlet = gpuMesh.meshlets.data();
+    const Meshlet* meshletsEnd = meshlet + gpuMesh.meshlets.size();
+
+    static MultiDraw batch;
+
+    glBindVertexArray(gpuMesh.VAO);
+    size_t drawn = 0;
+    size_t first = 0;
+    while (first < partCount) {
+        int materialId = parts[first].materialId;
+        size_t last = first;
+        batch.clear();
+        // Visible neighbours are one range; the common all-visible case
+        // turns into a single range per material.
+        size_t rangeStart = 0, rangeEnd = 0;
+        auto addRange = [&](size_t offset, size_t count) {
+            if (rangeEnd != offset) {
+                if (rangeEnd > rangeStart) batch.add(gpuMesh, rangeStart, rangeEnd - rangeStart);
+                drawn += rangeEnd - rangeStart;
+                rangeStart = offset;
+            }
+            rangeEnd = offset + count;
+        };
+        for (; last < partCount && parts[last].materialId == materialId; ++last) {
+            const Submesh& submesh = parts[last];
+            if (hasParts && isVisible && !isVisible(submesh)) continue;
+            if (!cullMeshlets) {
+                addRange(submesh.indexOffset, submesh.indexCount);
+                continue;
+            }
+            // Both lists are in index order, so one pointer walks the
+            // meshlets of every submesh.
+            size_t submeshEnd = size_t(submesh.indexOffset) + submesh.indexCount;
+            while (meshlet != meshletsEnd && meshlet->indexOffset < submesh.indexOffset) ++meshlet;
+            for (; meshlet != meshletsEnd && meshlet->indexOffset < submeshEnd; ++meshlet) {
+                if (isMeshletVisible(*meshlet)) addRange(meshlet->indexOffset, meshlet->indexCount);
+            }
+        }
+        if (rangeEnd > rangeStart) batch.add(gpuMesh, rangeStart, rangeEnd - rangeStart);
+        drawn += rangeEnd - rangeStart;
+        if (!batch.counts.empty()) {
+            if (beginMaterial) beginMaterial(materialId);
+            batch.draw(gpuMesh);
+        }
+        first = last;
+    }
+    glBindVertexArray(0);
+    return drawn;
+}
+
+void drawOutlines(const GpuMesh& gpuMesh, const std::vector<unsigned int>& lines) {
+    if (gpuMesh.outlineVAO == 0 || lines.empty()) return;
+    const std::vector<unsigned int>* data = &lines;
+    if (!gpuMesh.outlineVertices.empty()) {
+        static std::vector<unsigned int> remapped;
+        remapped.resize(lines.size());
+        for (size_t i = 0; i < lines.size(); ++i) remapped[i] = gpuMesh.outlineVertices[lines[i]];
+        data = &remapped;
+    }
+    glBindVertexArray(gpuMesh.outlineVAO);
+    // Orphan last frame's lines rather than wait for the GPU to finish them.
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, data->size() * sizeof(unsigned int), data->data(), GL_STREAM_DRAW);
+    glDrawElements(GL_LINES, static_cast<GLsizei>(lines.size()), GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0);
+}
+
+void destroyMesh(GpuMesh& gpuMesh) {
+    if (gpuMesh.VAO != 0) {
+        glDeleteVertexArrays(1, &gpuMesh.VAO);
+        glDeleteBuffers(1, &gpuMesh.VBO);
+        glDeleteBuffers(1, &gpuMesh.EBO);
+    }
+    if (gpuMesh.outlineVAO != 0) {
+        glDeleteVertexArrays(1, &gpuMesh.outlineVAO);
+        glDeleteBuffers(1, &gpuMesh.outlineEBO);
+    }
+    gpuMesh = GpuMesh();
+}
+
+MeshData makePlaceholderMesh(float radius) {
+    const glm::vec3 axes[6] = {
+        glm::vec3(radius, 0, 0), glm::vec3(-radius, 0, 0),
+        glm::vec3(0, radius, 0), glm::vec3(0, -radius, 0),
+        glm::vec3(0, 0, radius), glm::vec3(0, 0, -radius)
+    };
+    const int faces[8][3] = {
+        { 0, 2, 4 }, { 4, 2, 1 }, { 1, 2, 5 }, { 5, 2, 0 },
+        { 4, 3, 0 }, { 1, 3, 4 }, { 5, 3, 1 }, { 0, 3, 5 }
+    };
+
+    MeshData mesh;
+    for (const auto& face : faces) {
+        glm::vec3 normal = glm::normalize(glm::cross(axes[face[1]] - axes[face[0]], axes[face[2]] - axes[face[0]]));
+        for (int corner : face) {
+            Vertex vertex;
+            vertex.Position = axes[corner];
+            vertex.Normal = normal;
+            mesh.indices.push_back(static_cast<unsigned int>(mesh.vertices.size()));
+            mesh.vertices.push_back(vertex);
+        }
+    }
+    mesh.computeBounds();
+    return mesh;
+}
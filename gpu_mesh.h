@@ -0,0 +1,112 @@
+#ifndef GPU_MESH_H
+#define GPU_MESH_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "mesh.h"
+#include "vertex_quantize.h"
+
+// VAO/VBO/EBO for one MeshData, laid out as Vertex or QuantizedVertex
+// (location 0 = position, location 1 = normal). Must be created and drawn on
+// the GL thread.
+struct GpuMesh {
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    size_t indexCount = 0;
+    // Second VAO over the same VBO for outline lines (see drawOutlines);
+    // only created for meshes with MeshData::edges.
+    unsigned int outlineVAO = 0;
+    unsigned int outlineEBO = 0;
+    // VBO entry of each mesh vertex when the VBO holds the 16-bit chunk
+    // layout (MeshData::chunkVertices); empty when it is the vertex array.
+    std::vector<unsigned int> outlineVertices;
+    // Maps the stored positions to mesh space; identity unless quantized.
+    // Multiply it into the model matrix (but not the normal matrix) and set
+    // the shader's octahedralNormals from the flag.
+    glm::mat4 positionTransform = glm::mat4(1.0f);
+    bool octahedralNormals = false;
+    // GL_UNSIGNED_SHORT when uploaded from MeshData::shortIndices; each chunk
+    // is then drawn with its base vertex into the VBO, which holds
+    // MeshData::chunkVertices rather than the vertex array if that is set.
+    unsigned int indexType = 0;
+    std::vector<IndexChunk> indexChunks;
+    // Copied from MeshData, sorted by material. indexCount covers the full
+    // resolution only; the LOD levels follow it in the EBO.
+    std::vector<Submesh> submeshes;
+    std::vector<MeshMaterial> materials;
+    std::vector<MeshLod> lods;
+    std::vector<Submesh> lodSubmeshes;
+    std::vector<Meshlet> meshlets;
+    // Bounding sphere in mesh space, for picking a LOD (see selectLod).
+    glm::vec3 sphereCenter = glm::vec3(0.0f);
+    float sphereRadius = 0.0f;
+    // Finest level whose indices are in the EBO, numbered as for
+    // drawSubmeshes' lod; lods.size() + 1 while none is. Only differs from 0
+    // while a MeshUploadStream is filling the buffers.
+    size_t finestLevel = 0;
+
+    bool drawable() const { return finestLevel <= lods.size(); }
+};
+
+// quantize uploads 12-byte QuantizedVertex data (vertex_quantize.h) instead
+// of the 24-byte Vertex array.
+void uploadMesh(const MeshData& mesh, GpuMesh& gpuMesh, bool quantize = false);
+
+// The same upload spread over several calls (frames), so a huge mesh doesn't
+// stall one. The constructor sizes the buffers; advance() fills them with
+// glBufferSubData, the vertices first and then the index ranges from the
+// coarsest LOD level to full resolution. gpuMesh.finestLevel follows the
+// levels as they land, so the model can be drawn, and sharpens, while the
+// rest streams in. mesh must stay alive and unchanged until done().
+class MeshUploadStream {
+public:
+    MeshUploadStream(const MeshData& mesh, GpuMesh& gpuMesh, bool quantize = false);
+
+    // Uploads about byteBudget more bytes (at least one vertex or index)
+    // and returns how many it uploaded.
+    size_t advance(size_t byteBudget);
+    bool done() const { return finished; }
+
+private:
+    MeshUploadStream(const MeshUploadStream&);
+    MeshUploadStream& operator=(const MeshUploadStream&);
+
+    const MeshData& mesh;
+    GpuMesh& gpuMesh;
+    bool quantize;
+    size_t verticesUploaded = 0;
+    size_t level;               // being uploaded, counting down to 0
+    size_t levelUploaded = 0;   // indices of it already in
+    bool finished = false;
+    std::vector<QuantizedVertex> quantized;
+    std::vector<Vertex> gathered;
+};
+void drawMesh(const GpuMesh& gpuMesh);
+
+// Draws the submeshes that pass isVisible (all of them if it is empty) with
+// one glMultiDrawElements per material, so the draw-call count follows the
+// material count rather than the part count. beginMaterial(materialId) runs
+// before each material's batch (-1 = no material). A mesh without submeshes
+// is drawn as one range under material -1. lod picks the level: 0 is full
+// resolution, k is gpuMesh.lods[k - 1]. At full resolution, the meshlets of
+// the visible submeshes that fail isMeshletVisible are left out as well
+// (see MeshletCuller); the survivors still go out in the same multi-draw.
+// Returns the number of indices drawn.
+size_t drawSubmeshes(const GpuMesh& gpuMesh, const std::function<void(int)>& beginMaterial,
+                     const std::function<bool(const Submesh&)>& isVisible = std::function<bool(const Submesh&)>(),
+                     size_t lod = 0,
+                     const std::function<bool(const Meshlet&)>& isMeshletVisible = std::function<bool(const Meshlet&)>());
+
+// Draws GL_LINES between the vertex pairs in lines (see extractOutlines)
+// with the current program, refilling the outline index buffer first.
+// Does nothing for meshes uploaded without edges.
+void drawOutlines(const GpuMesh& gpuMesh, const std::vector<unsigned int>& lines);
+void destroyMesh(GpuMesh& gpuMesh);
+
+// Small flat-shaded octahedron shown while the real model is still loading.
+MeshData makePlaceholderMesh(float radius);
+
+#endif
@@ -0,0 +1,164 @@
+#include "index_chunks.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+const size_t RANGE_SIZE = size_t(1) << 16;
+// Full-resolution chunks stop this far short of RANGE_SIZE when there are
+// LOD levels, leaving room in their ranges for the few vertices the LOD
+// triangles drawn through them reach outside.
+const size_t LOD_SLACK = 4096;
+const unsigned int NO_RANGE = 0xFFFFFFFFu;
+
+// The vertex ranges chunks draw from, each at most RANGE_SIZE entries. A
+// vertex's home is the first range it was added to; copies in later ranges
+// are looked up by (range, vertex).
+struct VertexRanges {
+    std::vector<std::vector<unsigned int>> entries;
+    std::vector<unsigned int> home;
+    std::vector<uint16_t> homeSlot;
+    std::unordered_map<uint64_t, uint16_t> copies;
+
+    explicit VertexRanges(size_t vertexCount) : home(vertexCount, NO_RANGE), homeSlot(vertexCount) {}
+
+    static uint64_t key(unsigned int range, unsigned int v) { return (uint64_t(range) << 32) | v; }
+
+    unsigned int create() {
+        entries.push_back(std::vector<unsigned int>());
+        return static_cast<unsigned int>(entries.size() - 1);
+    }
+
+    // Slot of v in range, or -1 if it is not there.
+    int find(unsigned int range, unsigned int v) const {
+        if (home[v] == range) return homeSlot[v];
+        if (home[v] == NO_RANGE) return -1;
+        auto it = copies.find(key(range, v));
+        return it == copies.end() ? -1 : it->second;
+    }
+
+    int insert(unsigned int range, unsigned int v) {
+        int slot = find(range, v);
+        if (slot >= 0) return slot;
+        slot = static_cast<int>(entries[range].size());
+        entries[range].push_back(v);
+        if (home[v] == NO_RANGE) {
+            home[v] = range;
+            homeSlot[v] = static_cast<uint16_t>(slot);
+        }
+        else {
+            copies[key(range, v)] = static_cast<uint16_t>(slot);
+        }
+        return slot;
+    }
+
+    // Corners of the triangle that range lacks, each counted once.
+    size_t missing(unsigned int range, const unsigned int* triangle) const {
+        size_t count = 0;
+        for (int c = 0; c < 3; ++c) {
+            bool repeated = (c > 0 && triangle[c] == triangle[0]) || (c > 1 && triangle[c] == triangle[1]);
+            if (!repeated && find(range, triangle[c]) < 0) ++count;
+        }
+        return count;
+    }
+
+    bool fits(unsigned int range, const unsigned int* triangle, size_t limit) const {
+        return entries[range].size() + missing(range, triangle) <= limit;
+    }
+};
+
+}  // namespace
+
+bool packShortIndices(MeshData& meshData) {
+    meshData.shortIndices.clear();
+    meshData.indexChunks.clear();
+    meshData.chunkVertices.clear();
+
+    const unsigned int* indices = meshData.indexData();
+    size_t count = meshData.indexCount() - meshData.indexCount() % 3;
+    size_t vertexCount = meshData.vertexCount();
+    if (count == 0 || count > 0xFFFFFFFFu || vertexCount >= NO_RANGE) return false;
+    for (size_t i = 0; i < count; ++i) {
+        if (indices[i] >= vertexCount) return false;
+    }
+
+    if (vertexCount <= RANGE_SIZE) {
+        IndexChunk whole;
+        whole.indexCount = static_cast<unsigned int>(count);
+        meshData.indexChunks.push_back(whole);
+        meshData.shortIndices.assign(indices, indices + count);
+        return true;
+    }
+
+    // Chunks also end where each LOD level starts.
+    std::vector<size_t> levelStarts;
+    for (const MeshLod& lod : meshData.lods) levelStarts.push_back(lod.indexOffset);
+    size_t nextLevel = 0;
+    size_t baseCount = std::min(count, meshData.baseIndexCount());
+    size_t baseLimit = meshData.lods.empty() ? RANGE_SIZE : RANGE_SIZE - LOD_SLACK;
+
+    VertexRanges ranges(vertexCount);
+    std::vector<IndexChunk> chunks;
+    std::vector<unsigned int> chunkRanges;
+    std::vector<uint16_t> shortIndices(count);
+    unsigned int current = NO_RANGE;
+    for (size_t i = 0; i < count; i += 3) {
+        const unsigned int* triangle = indices + i;
+        bool levelStart = false;
+        while (nextLevel < levelStarts.size() && levelStarts[nextLevel] <= i) {
+            levelStart = levelStart || levelStarts[nextLevel] == i;
+            ++nextLevel;
+        }
+
+        unsigned int target = levelStart ? NO_RANGE : current;
+        if (i < baseCount) {
+            // Full resolution: a run of triangles fills one new range.
+            if (target == NO_RANGE || !ranges.fits(target, triangle, baseLimit)) target = ranges.create();
+        }
+        else {
+            // A LOD level draws through the range its vertices live in,
+            // copying in the few from elsewhere; switching ranges starts a
+            // new chunk, so stay put while the copies fit.
+            unsigned int home = ranges.home[triangle[0]];
+            bool homeHasAll = home != NO_RANGE && home != target && ranges.missing(home, triangle) == 0;
+            bool stay = target != NO_RANGE && (ranges.missing(target, triangle) == 0 ||
+                                               (!homeHasAll && ranges.fits(target, triangle, RANGE_SIZE)));
+            if (!stay) {
+                if (home != NO_RANGE && ranges.fits(home, triangle, RANGE_SIZE)) target = home;
+                else target = ranges.create();
+            }
+        }
+        if (target != current || levelStart) {
+            IndexChunk chunk;
+            chunk.indexOffset = static_cast<unsigned int>(i);
+            chunks.push_back(chunk);
+            chunkRanges.push_back(target);
+            current = target;
+        }
+
+        for (int c = 0; c < 3; ++c) {
+            shortIndices[i + c] = static_cast<uint16_t>(ranges.insert(current, triangle[c]));
+        }
+        chunks.back().indexCount += 3;
+    }
+
+    std::vector<unsigned int> rangeBases;
+    std::vector<unsigned int> chunkVertices;
+    for (const std::vector<unsigned int>& entries : ranges.entries) {
+        rangeBases.push_back(static_cast<unsigned int>(chunkVertices.size()));
+        chunkVertices.insert(chunkVertices.end(), entries.begin(), entries.end());
+    }
+    // Copies cost a whole vertex each (less once quantized); only pack while
+    // they take less room than the two bytes saved per index.
+    if (chunkVertices.size() > vertexCount &&
+        (chunkVertices.size() - vertexCount) * sizeof(Vertex) >= 2 * count) {
+        return false;
+    }
+    for (size_t c = 0; c < chunks.size(); ++c) chunks[c].baseVertex = rangeBases[chunkRanges[c]];
+
+    meshData.shortIndices.swap(shortIndices);
+    meshData.indexChunks.swap(chunks);
+    meshData.chunkVertices.swap(chunkVertices);
+    return true;
+}
@@ -0,0 +1,22 @@
+#ifndef INDEX_CHUNKS_H
+#define INDEX_CHUNKS_H
+
+#include "mesh.h"
+
+// Splits the index buffer, in order, into runs of triangles that use at
+// most 65536 distinct vertices and gives each run (IndexChunk) its own
+// range of the GPU vertex buffer: meshData.chunkVertices lists the vertices
+// of every chunk in first-use order, and meshData.shortIndices holds each
+// index as a position in its chunk's range. A vertex used by several chunks
+// is copied into each, so nothing depends on how far apart the ids of a
+// triangle are. The full-resolution mesh and each LOD level start a new
+// chunk. A mesh with at most 65536 vertices is one chunk over its own
+// vertex array.
+//
+// Run it after the last pass that reorders vertices or indices. Gives up
+// (leaving all three arrays empty, so the mesh is drawn from 32-bit
+// indices) when the copies would take more room than the 16-bit indices
+// save. Returns whether the mesh was packed.
+bool packShortIndices(MeshData& meshData);
+
+#endif
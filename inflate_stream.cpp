@@ -0,0 +1,417 @@
+#include "inflate_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+/* The block structure, tables and code-length decoding follow picoPNG
+ * version 20101224, Copyright (c) 2005-2010 Lode Vandevenne (see
+ * hw4_helpers/png.cpp for the full notice). This is an altered version.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+namespace {
+
+const unsigned int WINDOW_SIZE = 32768;
+
+const uint16_t LENBASE[29] =  {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+const uint8_t  LENEXTRA[29] = {0,0,0,0,0,0,0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4,  4,  5,  5,  5,  5,  0};
+const uint16_t DISTBASE[30] =  {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+const uint8_t  DISTEXTRA[30] = {0,0,0,0,1,1,2, 2, 3, 3, 4, 4, 5, 5,  6,  6,  7,  7,  8,  8,   9,   9,  10,  10,  11,  11,  12,   12,   13,   13};
+const uint8_t  CLCL[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15}; //code length code lengths
+
+enum { FIXED_LITERALS, FIXED_DISTANCES, DYNAMIC_LITERALS, DYNAMIC_DISTANCES };
+
+struct Crc32Table {
+    uint32_t entries[256];
+    Crc32Table() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[n] = c;
+        }
+    }
+};
+
+uint32_t updateCrc32(uint32_t crc, const unsigned char* data, size_t size) {
+    static const Crc32Table table;
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+uint32_t readLE32(const unsigned char* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+}  // namespace
+
+
+bool InflateStream::buildHuffman(Huffman& huffman, const uint8_t* lengths, unsigned int count) {
+    std::memset(&huffman, 0, sizeof(huffman));
+    for (unsigned int s = 0; s < count; ++s) huffman.count[lengths[s]]++;
+    huffman.count[0] = 0;
+
+    // Reject over-subscribed codes; incomplete ones are legal (e.g. a single
+    // distance code) and simply fail to decode the missing patterns.
+    int left = 1;
+    for (int len = 1; len < 16; ++len) {
+        left <<= 1;
+        left -= huffman.count[len];
+        if (left < 0) return false;
+    }
+
+    uint16_t offsets[16];
+    offsets[1] = 0;
+    for (int len = 1; len < 15; ++len) offsets[len + 1] = offsets[len] + huffman.count[len];
+    for (unsigned int s = 0; s < count; ++s) {
+        if (lengths[s] != 0) huffman.symbol[offsets[lengths[s]]++] = static_cast<uint16_t>(s);
+    }
+
+    // Canonical codes are assigned in symbol order within each length; the
+    // stream sends them most significant bit first, so the table is indexed
+    // by the reversed code.
+    unsigned int code = 0, index = 0;
+    for (unsigned int len = 1; len <= FAST_BITS; ++len) {
+        for (unsigned int i = 0; i < huffman.count[len]; ++i, ++code, ++index) {
+            unsigned int reversed = 0;
+            for (unsigned int b = 0; b < len; ++b) reversed |= ((code >> b) & 1u) << (len - 1 - b);
+            uint16_t entry = static_cast<uint16_t>((huffman.symbol[index] << 4) | len);
+            for (unsigned int slot = reversed; slot < (1u << FAST_BITS); slot += 1u << len) huffman.fast[slot] = entry;
+        }
+        code <<= 1;
+    }
+    return true;
+}
+
+InflateStream::InflateStream(const unsigned char* data, size_t size, Format format)
+    : input(data), inputSize(size), inputPos(0), format(format), bitBuffer(0), bitCount(0), paddingBytes(0),
+      state(MEMBER_HEADER), lastBlock(false), anyMember(false), storedRemaining(0), matchRemaining(0),
+      matchDistance(0), literals(nullptr), distances(nullptr), tables(4), window(WINDOW_SIZE),
+      memberOutput(0), crc(0), errorMessage(nullptr) {
+    uint8_t lengths[288];
+    for (unsigned int i = 0; i < 288; ++i) lengths[i] = (i < 144) ? 8 : (i < 256) ? 9 : (i < 280) ? 7 : 8;
+    buildHuffman(tables[FIXED_LITERALS], lengths, 288);
+    std::fill(lengths, lengths + 30, uint8_t(5));
+    buildHuffman(tables[FIXED_DISTANCES], lengths, 30);
+}
+
+bool InflateStream::fail(const char* message) {
+    if (!errorMessage) errorMessage = message;
+    state = DONE;
+    return false;
+}
+
+void InflateStream::refill() {
+    while (bitCount <= 56) {
+        uint64_t byte = 0;
+        if (inputPos < inputSize) byte = input[inputPos++];
+        else ++paddingBytes;
+        bitBuffer |= byte << bitCount;
+        bitCount += 8;
+    }
+}
+
+uint32_t InflateStream::bits(unsigned int count) {
+    if (bitCount < count) refill();
+    uint32_t value = static_cast<uint32_t>(bitBuffer & ((uint64_t(1) << count) - 1));
+    dropBits(count);
+    return value;
+}
+
+void InflateStream::dropBits(unsigned int count) {
+    bitBuffer >>= count;
+    bitCount -= count;
+}
+
+// True once bits beyond the end of the input have been consumed.
+bool InflateStream::overran() const {
+    return paddingBytes * 8 > bitCount;
+}
+
+// Drops the partial byte and hands whole buffered bytes back to the input,
+// so stored blocks and trailers can be read directly.
+void InflateStream::alignToByte() {
+    dropBits(bitCount & 7);
+    size_t buffered = bitCount / 8;
+    size_t real = buffered > paddingBytes ? buffered - paddingBytes : 0;
+    inputPos -= real;
+    paddingBytes = 0;
+    bitBuffer = 0;
+    bitCount = 0;
+}
+
+int InflateStream::decodeSymbol(const Huffman& huffman) {
+    if (bitCount < 15) refill();
+    uint16_t entry = huffman.fast[bitBuffer & ((1u << FAST_BITS) - 1)];
+    if (entry != 0) {
+        dropBits(entry & 15);
+        return entry >> 4;
+    }
+    int code = 0, first = 0, index = 0;
+    for (unsigned int len = 1; len < 16; ++len) {
+        code |= static_cast<int>((bitBuffer >> (len - 1)) & 1);
+        int count = huffman.count[len];
+        if (code - count < first) {
+            dropBits(len);
+            return huffman.symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+bool InflateStream::readMemberHeader() {
+    // Anything after the last gzip member that isn't another member (zero
+    // padding, trailing garbage) is ignored, like gzip does.
+    if (anyMember && (format != GZIP || !hasGzipMagic(input + inputPos, inputSize - inputPos))) {
+        state = DONE;
+        return true;
+    }
+
+    if (format == ZLIB) {
+        if (inputSize - inputPos < 2) return fail("zlib header truncated");
+        const unsigned char* p = input + inputPos;
+        if ((p[0] * 256 + p[1]) % 31 != 0 || (p[0] & 15) != 8 || ((p[0] >> 4) & 15) > 7) return fail("bad zlib header");
+        if ((p[1] >> 5) & 1) return fail("zlib preset dictionaries are not supported");
+        inputPos += 2;
+    }
+    else if (format == GZIP) {
+        if (inputSize - inputPos < 10) return fail("gzip header truncated");
+        const unsigned char* p = input + inputPos;
+        if (!hasGzipMagic(p, 10) || p[2] != 8) return fail("not a deflate gzip member");
+        unsigned int flags = p[3];
+        size_t pos = inputPos + 10;
+        if (flags & 4) {  // FEXTRA
+            if (inputSize - pos < 2) return fail("gzip header truncated");
+            pos += 2 + (input[pos] | (size_t(input[pos + 1]) << 8));
+        }
+        for (unsigned int flag = 8; flag <= 16; flag <<= 1) {  // FNAME, FCOMMENT
+            if (!(flags & flag)) continue;
+            while (pos < inputSize && input[pos] != 0) ++pos;
+            ++pos;
+        }
+        if (flags & 2) pos += 2;  // FHCRC
+        if (pos > inputSize) return fail("gzip header truncated");
+        inputPos = pos;
+    }
+
+    anyMember = true;
+    lastBlock = false;
+    memberOutput = 0;
+    crc = 0;
+    state = BLOCK_HEADER;
+    return true;
+}
+
+bool InflateStream::readDynamicTables() {
+    uint8_t lengths[288 + 32];
+    uint8_t codeLengthLengths[19] = {};
+    unsigned int hlit = bits(5) + 257; //number of literal/length codes + 257
+    unsigned int hdist = bits(5) + 1; //number of dist codes + 1
+    unsigned int hclen = bits(4) + 4; //number of code length codes + 4
+    if (hlit > 286 || hdist > 30) return fail("bad dynamic block header");
+    for (unsigned int i = 0; i < hclen; ++i) codeLengthLengths[CLCL[i]] = static_cast<uint8_t>(bits(3));
+
+    Huffman& codeLengths = tables[DYNAMIC_LITERALS];  // reused before the literal table is built
+    if (!buildHuffman(codeLengths, codeLengthLengths, 19)) return fail("bad code length code");
+
+    unsigned int i = 0;
+    while (i < hlit + hdist) {
+        int code = decodeSymbol(codeLengths);
+        if (code < 0 || overran()) return fail("bad code lengths");
+        if (code <= 15) { lengths[i++] = static_cast<uint8_t>(code); continue; } //a length code
+        unsigned int value = 0, repeat;
+        if (code == 16) { //repeat previous
+            if (i == 0) return fail("bad code lengths");
+            value = lengths[i - 1];
+            repeat = 3 + bits(2);
+        }
+        else if (code == 17) repeat = 3 + bits(3); //repeat "0" 3-10 times
+        else repeat = 11 + bits(7); //repeat "0" 11-138 times
+        if (i + repeat > hlit + hdist) return fail("bad code lengths");
+        std::fill(lengths + i, lengths + i + repeat, static_cast<uint8_t>(value));
+        i += repeat;
+    }
+    if (lengths[256] == 0) return fail("missing end-of-block code"); //the length of the end code 256 must be larger than 0
+    if (!buildHuffman(tables[DYNAMIC_LITERALS], lengths, hlit) ||
+        !buildHuffman(tables[DYNAMIC_DISTANCES], lengths + hlit, hdist)) {
+        return fail("bad dynamic Huffman code");
+    }
+    literals = &tables[DYNAMIC_LITERALS];
+    distances = &tables[DYNAMIC_DISTANCES];
+    return true;
+}
+
+bool InflateStream::readBlockHeader() {
+    if (lastBlock) {
+        state = TRAILER;
+        return true;
+    }
+    lastBlock = bits(1) != 0;
+    unsigned int type = bits(2);
+    if (overran()) return fail("deflate data truncated");
+
+    if (type == 0) {
+        alignToByte();
+        if (inputSize - inputPos < 4) return fail("deflate data truncated");
+        const unsigned char* p = input + inputPos;
+        unsigned int len = p[0] + 256u * p[1], nlen = p[2] + 256u * p[3];
+        if (len + nlen != 65535) return fail("bad stored block length"); //NLEN is not one's complement of LEN
+        inputPos += 4;
+        if (inputSize - inputPos < len) return fail("deflate data truncated");
+        storedRemaining = len;
+        state = STORED;
+        return true;
+    }
+    if (type == 1) {
+        literals = &tables[FIXED_LITERALS];
+        distances = &tables[FIXED_DISTANCES];
+    }
+    else if (type == 2) {
+        if (!readDynamicTables()) return false;
+    }
+    else {
+        return fail("invalid deflate block type");
+    }
+    state = CODES;
+    return true;
+}
+
+bool InflateStream::readTrailer() {
+    alignToByte();
+    if (format == GZIP) {
+        if (inputSize - inputPos < 8) return fail("gzip trailer truncated");
+        if (readLE32(input + inputPos) != crc) return fail("gzip CRC mismatch");
+        if (readLE32(input + inputPos + 4) != uint32_t(memberOutput)) return fail("gzip size mismatch");
+        inputPos += 8;
+    }
+    else if (format == ZLIB) {
+        inputPos = std::min(inputSize, inputPos + 4);
+    }
+    state = (format == GZIP) ? MEMBER_HEADER : DONE;
+    return true;
+}
+
+size_t InflateStream::read(unsigned char* out, size_t capacity) {
+    size_t written = 0;
+    size_t crcFrom = 0;
+    const unsigned int mask = WINDOW_SIZE - 1;
+
+    while (written < capacity && state != DONE) {
+        if (matchRemaining > 0) {
+            size_t count = std::min<size_t>(matchRemaining, capacity - written);
+            size_t from = size_t(memberOutput) - matchDistance;
+            for (size_t i = 0; i < count; ++i) {
+                unsigned char byte = window[(from + i) & mask];
+                window[(memberOutput + i) & mask] = byte;
+                out[written + i] = byte;
+            }
+            written += count;
+            memberOutput += count;
+            matchRemaining -= static_cast<unsigned int>(count);
+            continue;
+        }
+
+        switch (state) {
+        case MEMBER_HEADER:
+            readMemberHeader();
+            break;
+        case BLOCK_HEADER:
+            readBlockHeader();
+            break;
+        case STORED: {
+            size_t count = std::min(storedRemaining, capacity - written);
+            std::memcpy(out + written, input + inputPos, count);
+            for (size_t i = 0; i < count; ++i) window[(memberOutput + i) & mask] = input[inputPos + i];
+            inputPos += count;
+            written += count;
+            memberOutput += count;
+            storedRemaining -= count;
+            if (storedRemaining == 0) state = BLOCK_HEADER;
+            break;
+        }
+        case CODES:
+            // Literals are the hot path; stay in this loop until the block
+            // ends, a match starts or the output is full.
+            while (written < capacity) {
+                int symbol = decodeSymbol(*literals);
+                if (symbol < 256) {
+                    if (symbol < 0 || overran()) {
+                        fail(symbol < 0 ? "invalid literal/length code" : "deflate data truncated");
+                        break;
+                    }
+                    unsigned char byte = static_cast<unsigned char>(symbol);
+                    window[memberOutput & mask] = byte;
+                    out[written++] = byte;
+                    ++memberOutput;
+                    continue;
+                }
+                if (symbol == 256) { //end code
+                    state = BLOCK_HEADER;
+                    break;
+                }
+                if (symbol > 285) {
+                    fail("invalid literal/length code");
+                    break;
+                }
+                unsigned int length = LENBASE[symbol - 257] + bits(LENEXTRA[symbol - 257]);
+                int distanceCode = decodeSymbol(*distances);
+                if (distanceCode < 0 || distanceCode > 29) { //invalid dist code (30-31 are never used)
+                    fail("invalid distance code");
+                    break;
+                }
+                unsigned int distance = DISTBASE[distanceCode] + bits(DISTEXTRA[distanceCode]);
+                if (overran()) {
+                    fail("deflate data truncated");
+                    break;
+                }
+                if (distance > memberOutput) {
+                    fail("distance too far back");
+                    break;
+                }
+                matchRemaining = length;
+                matchDistance = distance;
+                break;
+            }
+            break;
+        case TRAILER:
+            crc = updateCrc32(crc, out + crcFrom, written - crcFrom);
+            crcFrom = written;
+            readTrailer();
+            break;
+        case DONE:
+            break;
+        }
+    }
+
+    if (errorMessage) return 0;
+    if (format == GZIP) crc = updateCrc32(crc, out + crcFrom, written - crcFrom);
+    return written;
+}
+
+InflateStreamBuf::int_type InflateStreamBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    size_t count = stream.read(buffer.data(), buffer.size());
+    if (count == 0) return traits_type::eof();
+    char* begin = reinterpret_cast<char*>(buffer.data());
+    setg(begin, begin, begin + count);
+    return traits_type::to_int_type(*gptr());
+}
@@ -0,0 +1,108 @@
+#ifndef INFLATE_STREAM_H
+#define INFLATE_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <vector>
+
+// Incremental DEFLATE (RFC 1951) decoder for a compressed buffer that is
+// already in memory, e.g. a mapped .obj.gz. read() produces the output a
+// piece at a time, keeping only the 32 KiB window between calls, so a large
+// file never has to be decompressed to disk or into one big buffer.
+//
+// Based on the picoPNG Inflator, altered to resume mid-block on a full
+// output buffer, to decode Huffman codes through lookup tables instead of a
+// bit-at-a-time tree walk, and to read gzip framing. It is the one DEFLATE
+// decoder in the tree: hw4_helpers/png.cpp decodes its IDAT data with it.
+class InflateStream {
+public:
+    // GZIP accepts concatenated members and checks each one's CRC-32 and
+    // size. ZLIB skips the Adler-32 check, like png.cpp.
+    enum Format { RAW_DEFLATE, ZLIB, GZIP };
+
+    InflateStream(const unsigned char* data, size_t size, Format format);
+
+    // Writes up to capacity bytes and returns how many were written. Returns
+    // 0 once the stream is finished or failed; see error().
+    size_t read(unsigned char* out, size_t capacity);
+
+    bool finished() const { return state == DONE; }
+    // nullptr while the stream is intact.
+    const char* error() const { return errorMessage; }
+
+    static bool hasGzipMagic(const unsigned char* data, size_t size) {
+        return size >= 2 && data[0] == 0x1F && data[1] == 0x8B;
+    }
+
+private:
+    static const unsigned int FAST_BITS = 10;
+
+    // Canonical Huffman code. Codes up to FAST_BITS long resolve with one
+    // lookup of the next (bit-reversed) input bits; longer ones fall back to
+    // walking count/symbol like zlib's puff.c.
+    struct Huffman {
+        uint16_t fast[1 << FAST_BITS];  // (symbol << 4) | length, 0 = longer code
+        uint16_t count[16];             // codes per length
+        uint16_t symbol[288];           // symbols ordered by code
+    };
+
+    static bool buildHuffman(Huffman& huffman, const uint8_t* lengths, unsigned int count);
+
+    enum State { MEMBER_HEADER, BLOCK_HEADER, STORED, CODES, TRAILER, DONE };
+
+    bool fail(const char* message);
+    void refill();
+    uint32_t bits(unsigned int count);
+    void dropBits(unsigned int count);
+    bool overran() const;
+    void alignToByte();
+    int decodeSymbol(const Huffman& huffman);
+
+    bool readMemberHeader();
+    bool readBlockHeader();
+    bool readDynamicTables();
+    bool readTrailer();
+
+    const unsigned char* input;
+    size_t inputSize;
+    size_t inputPos;
+    Format format;
+
+    uint64_t bitBuffer;
+    unsigned int bitCount;
+    size_t paddingBytes;  // zero bytes fed past the end of the input
+
+    State state;
+    bool lastBlock;
+    bool anyMember;
+    size_t storedRemaining;
+    unsigned int matchRemaining;
+    unsigned int matchDistance;
+    const Huffman* literals;
+    const Huffman* distances;
+    std::vector<Huffman> tables;  // fixed literal, fixed distance, dynamic x2
+
+    std::vector<unsigned char> window;
+    uint64_t memberOutput;  // bytes produced by the current member
+    uint32_t crc;
+
+    const char* errorMessage;
+};
+
+// std::streambuf over an InflateStream, for parsers that read istreams (e.g.
+// tinyobj). Each underflow() inflates the next bufferSize bytes.
+class InflateStreamBuf : public std::streambuf {
+public:
+    InflateStreamBuf(InflateStream& stream, size_t bufferSize = 1 << 16)
+        : stream(stream), buffer(bufferSize) {}
+
+protected:
+    int_type underflow() override;
+
+private:
+    InflateStream& stream;
+    std::vector<unsigned char> buffer;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "load_bench.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "obj_parser.h"
+
+namespace {
+
+struct BenchMode {
+    const char* name;
+    bool tinyobj;
+    bool mapInput;
+    bool simdScan;
+};
+
+const BenchMode BENCH_MODES[] = {
+    { "tinyobj LoadObj (ifstream)", true, false, false },
+    { "parallel, buffered read",    false, false, true },
+    { "parallel, mmap, scalar scan", false, true, false },
+    { "parallel, mmap",             false, true, true },
+};
+
+bool runOnce(const BenchMode& mode, const std::string& path, size_t& vertexCount) {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    setObjScannerSimd(mode.simdScan);
+    bool ok = mode.tinyobj
+        ? tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), objMaterialDir(path).c_str())
+        : loadObjParallel(&attrib, &shapes, &materials, &warn, &err, path.c_str(), 0, mode.mapInput);
+    if (!ok) {
+        std::cerr << "  " << mode.name << " failed: " << err << std::endl;
+        return false;
+    }
+    vertexCount = attrib.vertices.size() / 3;
+    return true;
+}
+
+}  // namespace
+
+
+int runLoadBenchmark(int argc, char* argv[]) {
+    int iterations = 5;
+    std::vector<std::string> files;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        }
+        else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) {
+        std::cout << "Usage: " << argv[0] << " --bench-load [--iterations N] model.obj [more.obj ...]" << std::endl;
+        return -1;
+    }
+
+    std::cout << "OBJ scanner: " << objScannerName() << std::endl;
+    bool allOk = true;
+    for (const std::string& path : files) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            std::cerr << "Cannot stat '" << path << "'" << std::endl;
+            allOk = false;
+            continue;
+        }
+        double megabytes = double(st.st_size) / (1024.0 * 1024.0);
+        std::cout << path << " (" << std::fixed << std::setprecision(1) << megabytes << " MB)" << std::endl;
+
+        for (const BenchMode& mode : BENCH_MODES) {
+            double best = 0.0, total = 0.0;
+            size_t vertexCount = 0;
+            bool ok = true;
+            for (int it = 0; it < iterations && ok; ++it) {
+                auto begin = std::chrono::steady_clock::now();
+                ok = runOnce(mode, path, vertexCount);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                best = (it == 0) ? ms : std::min(best, ms);
+                total += ms;
+            }
+            if (!ok) {
+                allOk = false;
+                continue;
+            }
+            std::cout << "  " << std::left << std::setw(30) << mode.name << std::right
+                      << " best " << std::setw(8) << std::setprecision(1) << best << " ms"
+                      << "  mean " << std::setw(8) << total / iterations << " ms"
+                      << "  " << std::setw(7) << megabytes / (best / 1000.0) << " MB/s"
+                      << "  (" << vertexCount << " positions)" << std::endl;
+        }
+    }
+    setObjScannerSimd(true);
+    return allOk ? 0 : -1;
+}
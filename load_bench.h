@@ -0,0 +1,10 @@
+#ifndef LOAD_BENCH_H
+#define LOAD_BENCH_H
+
+// Headless OBJ ingest microbenchmark, run as
+//   toon_shader_app --bench-load [--iterations N] model.obj [more.obj ...]
+// Times each input path over the same files and prints the best and mean
+// wall time and throughput. No window or GL context is created.
+int runLoadBenchmark(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,381 @@
+#include "lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "vertex_cache.h"
+
+namespace {
+
+const unsigned int UNUSED = 0xFFFFFFFFu;
+
+// A range stops shrinking at this many triangles; below it a collapse
+// changes the silhouette more than any saving is worth.
+const size_t MIN_RANGE_TRIANGLES = 8;
+
+// Sum of area-weighted squared distances to a set of planes, as a symmetric
+// 4x4 matrix, plus the total area it was built from.
+struct Quadric {
+    float xx = 0.0f, xy = 0.0f, xz = 0.0f, xw = 0.0f;
+    float yy = 0.0f, yz = 0.0f, yw = 0.0f;
+    float zz = 0.0f, zw = 0.0f;
+    float ww = 0.0f;
+    float weight = 0.0f;
+
+    void addPlane(const glm::vec3& n, float d, float w) {
+        xx += w * n.x * n.x; xy += w * n.x * n.y; xz += w * n.x * n.z; xw += w * n.x * d;
+        yy += w * n.y * n.y; yz += w * n.y * n.z; yw += w * n.y * d;
+        zz += w * n.z * n.z; zw += w * n.z * d;
+        ww += w * d * d;
+        weight += w;
+    }
+
+    Quadric& operator+=(const Quadric& o) {
+        xx += o.xx; xy += o.xy; xz += o.xz; xw += o.xw;
+        yy += o.yy; yz += o.yz; yw += o.yw;
+        zz += o.zz; zw += o.zw;
+        ww += o.ww;
+        weight += o.weight;
+        return *this;
+    }
+
+    float evaluate(const glm::vec3& p) const {
+        return xx * p.x * p.x + yy * p.y * p.y + zz * p.z * p.z + ww +
+               2.0f * (xy * p.x * p.y + xz * p.x * p.z + yz * p.y * p.z + xw * p.x + yw * p.y + zw * p.z);
+    }
+};
+
+// Mean squared distance from p to the planes of both quadrics.
+float collapseCost(const Quadric& a, const Quadric& b, const glm::vec3& p) {
+    float weight = a.weight + b.weight;
+    if (weight <= 0.0f) return 0.0f;
+    return std::max(0.0f, (a.evaluate(p) + b.evaluate(p)) / weight);
+}
+
+struct Collapse {
+    float cost;
+    unsigned int from;
+    unsigned int to;
+};
+
+// One submesh being simplified level after level. Per-vertex arrays are
+// compacted to the vertices the range uses.
+class RangeSimplifier {
+public:
+    // positions are the whole mesh's, normalized; pinned marks vertices that
+    // share their position with another vertex, and canonical maps each
+    // vertex to the first one at its position. localIndex is scratch of one
+    // entry per vertex, all UNUSED, and is left that way.
+    RangeSimplifier(const unsigned int* indices, size_t indexCount, const std::vector<glm::vec3>& positions,
+                    const std::vector<unsigned char>& pinned, const std::vector<unsigned int>& canonical,
+                    std::vector<unsigned int>& localIndex)
+        : maxCost(0.0f) {
+        size_t triangleCount = indexCount / 3;
+        corners.resize(3 * triangleCount);
+        for (size_t c = 0; c < corners.size(); ++c) {
+            unsigned int& local = localIndex[indices[c]];
+            if (local == UNUSED) {
+                local = static_cast<unsigned int>(globalIndex.size());
+                globalIndex.push_back(indices[c]);
+            }
+            corners[c] = local;
+        }
+        size_t vertexCount = globalIndex.size();
+        position.resize(vertexCount);
+        locked.assign(vertexCount, 0);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            position[v] = positions[globalIndex[v]];
+            locked[v] = pinned[globalIndex[v]];
+        }
+
+        quadrics.assign(vertexCount, Quadric());
+        for (size_t t = 0; t < triangleCount; ++t) {
+            const glm::vec3& a = position[corners[3 * t]];
+            glm::vec3 normal = glm::cross(position[corners[3 * t + 1]] - a, position[corners[3 * t + 2]] - a);
+            float length = glm::length(normal);
+            if (length <= 0.0f) continue;
+            normal /= length;
+            float d = -glm::dot(normal, a);
+            for (int k = 0; k < 3; ++k) quadrics[corners[3 * t + k]].addPlane(normal, d, 0.5f * length);
+        }
+
+        // Edges between positions that don't have exactly two triangles are
+        // borders (or worse); their vertices stay put.
+        std::vector<uint64_t> edges;
+        edges.reserve(corners.size());
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (int k = 0; k < 3; ++k) {
+                uint64_t a = canonical[globalIndex[corners[3 * t + k]]];
+                uint64_t b = canonical[globalIndex[corners[3 * t + (k + 1) % 3]]];
+                if (a != b) edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (size_t e = 0; e < edges.size();) {
+            size_t run = e + 1;
+            while (run < edges.size() && edges[run] == edges[e]) ++run;
+            if (run - e != 2) {
+                for (unsigned int end : { unsigned(edges[e] >> 32), unsigned(edges[e] & 0xFFFFFFFFu) }) {
+                    if (localIndex[end] != UNUSED) locked[localIndex[end]] = 1;
+                }
+            }
+            e = run;
+        }
+
+        for (unsigned int g : globalIndex) localIndex[g] = UNUSED;
+        mark.assign(vertexCount, 0);
+        markStamp = 0;
+    }
+
+    size_t triangleCount() const { return corners.size() / 3; }
+
+    // Largest collapse cost accepted so far, in normalized units squared.
+    float error() const { return maxCost; }
+
+    void appendIndices(std::vector<unsigned int>& out) const {
+        for (unsigned int c : corners) out.push_back(globalIndex[c]);
+    }
+
+    // Collapses edges, cheapest first, until at most targetTriangles remain
+    // or no collapse is allowed. Each pass takes an independent set: a
+    // collapse freezes the one-ring of the removed vertex for the rest of
+    // the pass, so the flip test always sees current geometry.
+    void reduce(size_t targetTriangles) {
+        targetTriangles = std::max(targetTriangles, MIN_RANGE_TRIANGLES);
+        while (triangleCount() > targetTriangles) {
+            buildAdjacency();
+            collectCandidates();
+            if (candidates.empty()) return;
+
+            size_t goal = triangleCount() - targetTriangles;
+            size_t removed = 0;
+            touched.assign(position.size(), 0);
+            collapsedTo.assign(position.size(), UNUSED);
+            for (const Collapse& collapse : candidates) {
+                if (removed >= goal) break;
+                if (touched[collapse.from] || touched[collapse.to]) continue;
+                if (!linkCondition(collapse.from, collapse.to) || flips(collapse.from, collapse.to)) continue;
+
+                collapsedTo[collapse.from] = collapse.to;
+                quadrics[collapse.to] += quadrics[collapse.from];
+                maxCost = std::max(maxCost, collapse.cost);
+                for (unsigned int a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1]; ++a) {
+                    const unsigned int* triangle = &corners[3 * adjacency[a]];
+                    bool shared = false;
+                    for (int k = 0; k < 3; ++k) {
+                        touched[triangle[k]] = 1;
+                        shared = shared || triangle[k] == collapse.to;
+                    }
+                    if (shared) ++removed;
+                }
+            }
+            if (removed == 0) return;
+
+            size_t kept = 0;
+            for (size_t t = 0; t < triangleCount(); ++t) {
+                unsigned int v[3];
+                for (int k = 0; k < 3; ++k) {
+                    unsigned int c = corners[3 * t + k];
+                    v[k] = collapsedTo[c] == UNUSED ? c : collapsedTo[c];
+                }
+                if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2]) continue;
+                for (int k = 0; k < 3; ++k) corners[3 * kept + k] = v[k];
+                ++kept;
+            }
+            corners.resize(3 * kept);
+        }
+    }
+
+private:
+    void buildAdjacency() {
+        size_t vertexCount = position.size();
+        adjacencyStart.assign(vertexCount + 1, 0);
+        for (unsigned int c : corners) ++adjacencyStart[c + 1];
+        for (size_t v = 0; v < vertexCount; ++v) adjacencyStart[v + 1] += adjacencyStart[v];
+        adjacency.resize(corners.size());
+        fill.assign(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t c = 0; c < corners.size(); ++c) adjacency[fill[corners[c]]++] = static_cast<unsigned int>(c / 3);
+    }
+
+    // The cheapest collapse of every movable vertex onto a neighbour,
+    // sorted by cost.
+    void collectCandidates() {
+        candidates.clear();
+        for (unsigned int v = 0; v < position.size(); ++v) {
+            if (locked[v] || adjacencyStart[v] == adjacencyStart[v + 1]) continue;
+            Collapse best = { 0.0f, v, UNUSED };
+            for (unsigned int a = adjacencyStart[v]; a < adjacencyStart[v + 1]; ++a) {
+                for (int k = 0; k < 3; ++k) {
+                    unsigned int to = corners[3 * adjacency[a] + k];
+                    if (to == v) continue;
+                    float cost = collapseCost(quadrics[v], quadrics[to], position[to]);
+                    if (best.to == UNUSED || cost < best.cost) {
+                        best.cost = cost;
+                        best.to = to;
+                    }
+                }
+            }
+            if (best.to != UNUSED) candidates.push_back(best);
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+    }
+
+    // The edge's endpoints may share only the two vertices opposite it;
+    // otherwise the collapse pinches the surface.
+    bool linkCondition(unsigned int from, unsigned int to) {
+        markStamp += 2;
+        for (unsigned int a = adjacencyStart[from]; a < adjacencyStart[from + 1]; ++a) {
+            for (int k = 0; k < 3; ++k) mark[corners[3 * adjacency[a] + k]] = markStamp;
+        }
+        unsigned int common = 0;
+        for (unsigned int a = adjacencyStart[to]; a < adjacencyStart[to + 1]; ++a) {
+            for (int k = 0; k < 3; ++k) {
+                unsigned int w = corners[3 * adjacency[a] + k];
+                if (w == from || w == to || mark[w] != markStamp) continue;
+                mark[w] = markStamp + 1;
+                ++common;
+            }
+        }
+        return common <= 2;
+    }
+
+    // True if moving from onto to turns any remaining triangle around from
+    // by more than about 75 degrees (or flattens it).
+    bool flips(unsigned int from, unsigned int to) const {
+        for (unsigned int a = adjacencyStart[from]; a < adjacencyStart[from + 1]; ++a) {
+            const unsigned int* triangle = &corners[3 * adjacency[a]];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to) continue;
+            glm::vec3 before[3], after[3];
+            for (int k = 0; k < 3; ++k) {
+                before[k] = position[triangle[k]];
+                after[k] = triangle[k] == from ? position[to] : before[k];
+            }
+            glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(n0, n1) <= 0.25f * glm::length(n0) * glm::length(n1)) return true;
+        }
+        return false;
+    }
+
+    std::vector<unsigned int> globalIndex;
+    std::vector<unsigned int> corners;
+    std::vector<glm::vec3> position;
+    std::vector<unsigned char> locked;
+    std::vector<Quadric> quadrics;
+    float maxCost;
+
+    std::vector<unsigned int> adjacencyStart;
+    std::vector<unsigned int> adjacency;
+    std::vector<unsigned int> fill;
+    std::vector<Collapse> candidates;
+    std::vector<unsigned char> touched;
+    std::vector<unsigned int> collapsedTo;
+    std::vector<unsigned int> mark;
+    unsigned int markStamp;
+};
+
+}  // namespace
+
+
+size_t generateLods(MeshData& meshData, unsigned int levels) {
+    meshData.indices.resize(meshData.baseIndexCount());
+    meshData.lods.clear();
+    meshData.lodSubmeshes.clear();
+    size_t baseCount = meshData.indices.size() - meshData.indices.size() % 3;
+    const Vertex* vertices = meshData.vertexData();
+    size_t vertexCount = meshData.vertexCount();
+    if (levels == 0 || baseCount < 3 || vertexCount == 0) return 0;
+
+    // Work in the unit box so float quadrics keep their precision far from
+    // the origin.
+    glm::vec3 lo = vertices[0].Position, hi = lo;
+    for (size_t v = 1; v < vertexCount; ++v) {
+        lo = glm::min(lo, vertices[v].Position);
+        hi = glm::max(hi, vertices[v].Position);
+    }
+    glm::vec3 extent = hi - lo;
+    float scale = std::max(extent.x, std::max(extent.y, extent.z));
+    float radius = 0.5f * glm::length(extent);
+    if (scale <= 0.0f) return 0;
+    std::vector<glm::vec3> positions(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) positions[v] = (vertices[v].Position - lo) / scale;
+
+    // Vertices at the same position differ in normal (or part) and pin each
+    // other in place.
+    std::vector<unsigned int> order(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) order[v] = static_cast<unsigned int>(v);
+    auto less = [&positions](unsigned int a, unsigned int b) {
+        const glm::vec3& p = positions[a];
+        const glm::vec3& q = positions[b];
+        if (p.x != q.x) return p.x < q.x;
+        if (p.y != q.y) return p.y < q.y;
+        if (p.z != q.z) return p.z < q.z;
+        return a < b;
+    };
+    std::sort(order.begin(), order.end(), less);
+    std::vector<unsigned char> pinned(vertexCount, 0);
+    std::vector<unsigned int> canonical(vertexCount);
+    for (size_t i = 0; i < vertexCount;) {
+        size_t run = i + 1;
+        while (run < vertexCount && positions[order[run]] == positions[order[i]]) ++run;
+        for (size_t j = i; j < run; ++j) {
+            canonical[order[j]] = order[i];
+            pinned[order[j]] = run - i > 1;
+        }
+        i = run;
+    }
+
+    std::vector<Submesh> ranges = meshData.submeshes;
+    if (ranges.empty()) {
+        ranges.resize(1);
+        ranges[0].indexCount = static_cast<unsigned int>(baseCount);
+    }
+
+    std::vector<RangeSimplifier> simplifiers;
+    simplifiers.reserve(ranges.size());
+    std::vector<unsigned int> localIndex(vertexCount, UNUSED);
+    for (const Submesh& range : ranges) {
+        simplifiers.emplace_back(meshData.indices.data() + range.indexOffset, range.indexCount, positions, pinned,
+                                 canonical, localIndex);
+    }
+
+    size_t previous = baseCount / 3;
+    for (unsigned int level = 0; level < levels; ++level) {
+        size_t triangles = 0;
+        float cost = 0.0f;
+        for (RangeSimplifier& simplifier : simplifiers) {
+            simplifier.reduce(simplifier.triangleCount() / 2);
+            triangles += simplifier.triangleCount();
+            cost = std::max(cost, simplifier.error());
+        }
+        if (10 * triangles > 9 * previous) break;
+        previous = triangles;
+
+        MeshLod lod;
+        lod.error = std::sqrt(cost) * scale / radius;
+        lod.indexOffset = static_cast<unsigned int>(meshData.indices.size());
+        lod.indexCount = static_cast<unsigned int>(3 * triangles);
+        lod.submeshOffset = static_cast<unsigned int>(meshData.lodSubmeshes.size());
+        lod.submeshCount = meshData.submeshes.empty() ? 0 : static_cast<unsigned int>(ranges.size());
+        std::vector<Submesh> parts = ranges;
+        for (size_t r = 0; r < ranges.size(); ++r) {
+            parts[r].indexOffset = static_cast<unsigned int>(meshData.indices.size());
+            parts[r].indexCount = static_cast<unsigned int>(3 * simplifiers[r].triangleCount());
+            simplifiers[r].appendIndices(meshData.indices);
+        }
+        optimizeVertexCache(meshData.indices.data(), parts, vertexCount);
+        if (!meshData.submeshes.empty()) {
+            meshData.lodSubmeshes.insert(meshData.lodSubmeshes.end(), parts.begin(), parts.end());
+        }
+        meshData.lods.push_back(lod);
+    }
+    return meshData.lods.size();
+}
+
+size_t selectLod(const std::vector<MeshLod>& lods, float projectedRadius, float maxPixelError) {
+    size_t level = 0;
+    while (level < lods.size() && lods[level].error * projectedRadius <= maxPixelError) ++level;
+    return level;
+}
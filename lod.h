@@ -0,0 +1,32 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <cstddef>
+#include <vector>
+
+#include "mesh.h"
+
+// Builds up to levels coarser versions of the mesh by quadric edge collapse
+// (Garland & Heckbert 1997), each aiming for half the triangles of the one
+// before, and appends them to meshData.indices as MeshLod entries. Every
+// submesh is simplified on its own so materials and part bounds still hold.
+//
+// Vertices only ever collapse onto a neighbouring vertex, so the levels
+// share the vertex array. A vertex is never moved if it shares its position
+// with another vertex (a normal crease, texture seam or part boundary) or
+// sits on an open border, which keeps those discontinuities exact. Quadrics
+// are carried from level to level, so MeshLod::error, the area-weighted RMS
+// distance to the original surface relative to the bounding-sphere radius,
+// only grows. The chain stops early once a level no longer removes a tenth
+// of the triangles. Each level is ordered for the vertex cache.
+//
+// meshData.indices must hold the indices (not a mapping). Returns the number
+// of levels built.
+size_t generateLods(MeshData& meshData, unsigned int levels);
+
+// The coarsest level (1 = lods[0]; 0 = full resolution) whose error stays
+// within maxPixelError when the mesh's bounding sphere covers
+// projectedRadius pixels on screen.
+size_t selectLod(const std::vector<MeshLod>& lods, float projectedRadius, float maxPixelError = 1.0f);
+
+#endif
@@ -7,15 +7,29 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include <unordered_map> 
 #include <stdexcept>   
 #include <cmath>
-
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h" 
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <iomanip>
 
 #include "shader.h" 
+#include "mesh.h"
+#include "gpu_mesh.h"
+#include "async_mesh_load.h"
+#include "file_list.h"
+#include "thread_pool.h"
+#include "load_bench.h"
+#include "lod.h"
+#include "meshlet.h"
+#include "bvh.h"
+#include "outline.h"
+#include "vertex_quantize.h"
 
 
 const unsigned int SCR_WIDTH = 800;
@@ -44,33 +58,92 @@ float lastFrame = 0.0f;
 
 bool mouseButtonPressed = false;
 
-struct Vertex {
-    glm::vec3 Position;
-    glm::vec3 Normal;
+// C toggles per-meshlet culling, to compare the vertex work in the title.
+bool meshletCulling = true;
+bool cullingKeyDown = false;
+
+// B toggles back-face culling: GL_CULL_FACE plus dropping meshlets whose
+// normal cone faces away. Off by default, since scans and many sample
+// models are open surfaces whose inside shows through the holes.
+bool backFaceCulling = false;
+bool backFaceKeyDown = false;
+
+// O toggles the silhouette and crease outlines.
+bool outlines = true;
+bool outlineKeyDown = false;
+
+// A right click asks the next frame to cast a ray through the cursor
+// (window coordinates) and report the triangle it hits.
+bool pickRequested = false;
+double pickX = 0.0;
+double pickY = 0.0;
+
+// One entry per model passed on the command line.
+struct SceneModel {
+    std::unique_ptr<AsyncMeshLoad> load;
+    GpuMesh gpuMesh;
+    GpuMesh preview;                           // drawn until gpuMesh has a level
+    std::unique_ptr<MeshUploadStream> upload;  // while gpuMesh streams in
+    size_t uploadFrames = 0;
+    bool ready = false;
+    bool failed = false;
+    glm::vec3 slot = glm::vec3(0.0f);          // grid position of the model
+    glm::mat4 placement = glm::mat4(1.0f);     // fits the mesh into its slot
 };
 
-struct MeshData {
-    std::vector<Vertex>       vertices;
-    std::vector<unsigned int> indices;
-};
+// GPU upload per frame, shared by the models streaming in; about 5 ms at the
+// few GB/s a driver copies, which a 60 Hz frame absorbs.
+const size_t UPLOAD_BYTES_PER_FRAME = size_t(16) << 20;
+
+const float SCENE_SLOT_SPACING = 12.0f;
+const float SCENE_SLOT_SIZE = 10.0f;
+
+glm::vec3 sceneSlotPosition(size_t index, size_t count);
+glm::mat4 scenePlacement(const MeshData& mesh, size_t sceneSize);
+bool boxInFrustum(const glm::mat4& modelViewProjection, const glm::vec3& boxMin, const glm::vec3& boxMax);
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
-bool loadObjModel(const std::string& filepath, MeshData& meshData); 
 
 
 int main(int argc, char* argv[]) {
+    auto startupBegin = std::chrono::steady_clock::now();
 
-    std::string objFilePath = "tralalero-tralala.obj"; 
-    if (argc > 1) {
-        objFilePath = argv[1]; 
+    if (argc > 1 && std::string(argv[1]) == "--bench-load") {
+        return runLoadBenchmark(argc, argv);
     }
-    else {
-        std::cout << "Usage: " << argv[0] << " [path/to/model.obj]" << std::endl;
-        std::cout << "No OBJ path provided, using default: " << objFilePath << std::endl;
+
+    std::vector<std::string> objFilePaths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (isDirectory(arg)) {
+            std::vector<std::string> found = listFilesWithExtension(arg, ".obj");
+            std::vector<std::string> compressed = listFilesWithExtension(arg, ".obj.gz");
+            found.insert(found.end(), compressed.begin(), compressed.end());
+            std::vector<std::string> binaryGltf = listFilesWithExtension(arg, ".glb");
+            found.insert(found.end(), binaryGltf.begin(), binaryGltf.end());
+            std::vector<std::string> scans = listFilesWithExtension(arg, ".ply");
+            found.insert(found.end(), scans.begin(), scans.end());
+            std::sort(found.begin(), found.end());
+            if (found.empty()) std::cerr << "No .obj, .glb or .ply files found in directory: " << arg << std::endl;
+            objFilePaths.insert(objFilePaths.end(), found.begin(), found.end());
+        }
+        else {
+            objFilePaths.push_back(arg);
+        }
+    }
+    if (argc <= 1) {
+        objFilePaths.push_back("tralalero-tralala.obj");
+        std::cout << "Usage: " << argv[0] << " [path/to/model.obj[.gz] | path/to/model.glb | path/to/model.ply | path/to/directory ...]" << std::endl;
+        std::cout << "       " << argv[0] << " --bench-load [--iterations N] model.obj [...]" << std::endl;
+        std::cout << "No OBJ path provided, using default: " << objFilePaths[0] << std::endl;
+    }
+    if (objFilePaths.empty()) {
+        std::cerr << "No OBJ models to load." << std::endl;
+        return -1;
     }
 
 
@@ -105,52 +178,58 @@ int main(int argc, char* argv[]) {
     }
 
     glEnable(GL_DEPTH_TEST);
+    // Push the filled triangles back a little so outline lines along their
+    // edges win the depth test.
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.0f, 1.0f);
+
+    // Vertex shader invocations per frame, where the driver can count them;
+    // read back a few frames late rather than stalling.
+    GLuint statisticsQuery = 0;
+    bool statisticsPending = false;
+    GLuint64 vertexInvocations = 0;
+    if (GLEW_ARB_pipeline_statistics_query) glGenQueries(1, &statisticsQuery);
 
     Shader toonShader("shaders/toon.vert", "shaders/toon.frag");
-
-    MeshData mesh;
-    try {
-        if (!loadObjModel(objFilePath, mesh)) {
-            std::cerr << "Failed to load OBJ model: " << objFilePath << std::endl;
-            glfwTerminate();
-            return -1;
-        }
-        std::cout << "Loaded OBJ model '" << objFilePath << "' with "
-            << mesh.vertices.size() << " unique vertices and "
-            << mesh.indices.size() << " indices." << std::endl;
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Error loading OBJ: " << e.what() << std::endl;
-        glfwTerminate();
-        return -1;
+    Shader outlineShader("shaders/toon.vert", "shaders/outline.frag");
+
+    // Models are parsed, deduplicated and cached on a bounded pool; the loop
+    // below keeps presenting placeholders and uploads each finished mesh on
+    // this (the GL) thread.
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    ThreadPool loadPool(static_cast<unsigned int>(std::min<size_t>(objFilePaths.size(), hardwareThreads)));
+    MeshLoadOptions loadOptions;
+    loadOptions.optimizeVertexCache = true;
+    loadOptions.overdrawThreshold = 1.05f;
+    loadOptions.optimizeVertexFetch = true;
+    loadOptions.buildMeshlets = true;
+    loadOptions.buildBvh = true;
+    loadOptions.buildOutlineEdges = true;
+    loadOptions.lodLevels = 5;
+    loadOptions.previewCells = 64;
+    if (loadPool.size() > 1) {
+        // Share the cores between concurrent loads instead of oversubscribing
+        // (parseThreads == 1 would select tinyobj, so 2 is the floor).
+        loadOptions.parseThreads = std::max(2u, hardwareThreads / loadPool.size());
+        loadOptions.normals.threads = std::max(1u, hardwareThreads / loadPool.size());
     }
 
+    std::vector<SceneModel> scene(objFilePaths.size());
+    for (size_t i = 0; i < scene.size(); ++i) {
+        scene[i].load.reset(new AsyncMeshLoad(objFilePaths[i], loadPool, loadOptions));
+        scene[i].slot = sceneSlotPosition(i, scene.size());
+    }
+    size_t pendingModels = scene.size();
+    size_t failedModels = 0;
 
-    unsigned int VBO, VAO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), &mesh.vertices[0], GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), &mesh.indices[0], GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Position));
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    glEnableVertexAttribArray(1);
-
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
+    GpuMesh placeholder;
+    uploadMesh(makePlaceholderMesh(3.0f), placeholder);
+    double lastTitleUpdate = -1.0;
+    std::vector<unsigned int> outlineLines;  // refilled per model each frame
+    int exitCode = 0;
 
 
+    bool firstFramePresented = false;
     while (!glfwWindowShouldClose(window)) {
 
         float currentFrame = static_cast<float>(glfwGetTime());
@@ -174,6 +253,10 @@ int main(int argc, char* argv[]) {
 
         glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // Meshlet cone culling only drops clusters that show back faces, so
+        // it goes with culling the rest of the back faces.
+        if (backFaceCulling) glEnable(GL_CULL_FACE);
+        else glDisable(GL_CULL_FACE);
 
 
         toonShader.use();
@@ -186,33 +269,257 @@ int main(int argc, char* argv[]) {
         toonShader.setMat4("view", view);
 
 
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::rotate(model, glm::radians(modelPitch), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(modelYaw), glm::vec3(0.0f, 1.0f, 0.0f));
-
-        model = glm::scale(model, glm::vec3(50.5f, 50.5f, 50.5f)); 
-
-        model = glm::translate(model, glm::vec3(0.0f, -0.25f, 0.0f));
-        toonShader.setMat4("model", model);
+        if (pendingModels > 0) {
+            for (SceneModel& entry : scene) {
+                if (entry.ready || entry.failed) continue;
+                AsyncMeshLoad::State state = entry.load->state();
+                if (state == AsyncMeshLoad::READY) {
+                    // Only sizes the buffers; the data follows below under
+                    // the per-frame budget.
+                    MeshData& mesh = entry.load->mesh();
+                    entry.upload.reset(new MeshUploadStream(mesh, entry.gpuMesh, true));
+                    entry.placement = scenePlacement(mesh, scene.size());
+                    entry.ready = true;
+                    --pendingModels;
+                    std::cout << "Loaded OBJ model '" << entry.load->path() << "' with "
+                        << mesh.vertexCount() << " unique vertices and "
+                        << mesh.indexCount() << (mesh.shortIndices.empty() ? "" : " 16-bit") << " indices ("
+                        << (entry.gpuMesh.octahedralNormals ? sizeof(QuantizedVertex) : sizeof(Vertex)) << "-byte vertices) in " << entry.load->elapsedMs() << " ms ("
+                        << (mesh.fromCache ? "warm, mesh cache hit" : "cold, parsed file") << ")." << std::endl;
+                    continue;
+                }
+                const MeshData* preview = entry.load->preview();
+                if (preview && entry.preview.VAO == 0) {
+                    uploadMesh(*preview, entry.preview, true);
+                    entry.placement = scenePlacement(*preview, scene.size());
+                }
+                if (state == AsyncMeshLoad::FAILED) {
+                    std::cerr << entry.load->error() << std::endl;
+                    entry.failed = true;
+                    --pendingModels;
+                    ++failedModels;
+                }
+            }
 
-        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
-        toonShader.setMat3("normalMatrix", normalMatrix);
+            if (pendingModels == 0) {
+                glfwSetWindowTitle(window, "Toon Shading OBJ Example");
+                double sceneMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count();
+                if (scene.size() > 1) {
+                    std::cout << "Scene loaded: " << scene.size() - failedModels << " of " << scene.size()
+                        << " models in " << sceneMs << " ms on " << loadPool.size() << " threads." << std::endl;
+                }
+                if (failedModels == scene.size()) {
+                    exitCode = -1;
+                    glfwSetWindowShouldClose(window, true);
+                }
+            }
+            else if (currentFrame - lastTitleUpdate > 0.25) {
+                lastTitleUpdate = currentFrame;
+                std::string title = "Toon Shading OBJ Example - loading ";
+                if (scene.size() == 1) {
+                    title += objFilePaths[0] + " (" + scene[0].load->stageName() + ", ";
+                }
+                else {
+                    title += std::to_string(scene.size() - pendingModels) + "/" + std::to_string(scene.size()) + " models (";
+                }
+                title += std::to_string(static_cast<int>(
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - startupBegin).count())) + " s)";
+                glfwSetWindowTitle(window, title.c_str());
+            }
+        }
 
 
         toonShader.setVec3("lightDir", glm::normalize(glm::vec3(0.8f, 0.8f, 0.8f)));
         toonShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f)); 
-        toonShader.setVec3("objectColor", glm::vec3(0.6f, 0.6f, 0.6f)); 
+        const glm::vec3 defaultObjectColor = glm::vec3(0.6f, 0.6f, 0.6f);
         toonShader.setVec3("viewPos", cameraPos); 
 
+        if (statisticsPending) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(statisticsQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                glGetQueryObjectui64v(statisticsQuery, GL_QUERY_RESULT, &vertexInvocations);
+                statisticsPending = false;
+            }
+        }
+        bool measureFrame = statisticsQuery != 0 && !statisticsPending;
+        if (measureFrame) glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB, statisticsQuery);
+        size_t drawnIndices = 0;
+        size_t outlineEdges = 0;
+
+        // Coarsest level first, so each model is drawable after its vertices
+        // and one small index range, then sharpens as the finer ones land.
+        size_t uploadBudget = UPLOAD_BYTES_PER_FRAME;
+        for (SceneModel& entry : scene) {
+            if (!entry.upload) continue;
+            uploadBudget -= std::min(uploadBudget, entry.upload->advance(uploadBudget));
+            ++entry.uploadFrames;
+            if (entry.upload->done()) {
+                std::cout << "Streamed '" << entry.load->path() << "' to the GPU over " << entry.uploadFrames << " frames." << std::endl;
+                entry.upload.reset();
+                destroyMesh(entry.preview);
+            }
+            if (uploadBudget == 0) break;
+        }
+
+        // Unproject the clicked pixel through the near and far planes; each
+        // model below maps that segment into mesh space with its own matrix.
+        bool picking = pickRequested;
+        pickRequested = false;
+        glm::vec3 pickOrigin(0.0f), pickDirection(0.0f);
+        float pickDistance = std::numeric_limits<float>::infinity();
+        const SceneModel* pickedModel = nullptr;
+        MeshHit pickedHit;
+        glm::vec3 pickedPosition(0.0f);
+        double pickMs = 0.0;
+        if (picking) {
+            int windowWidth = 0, windowHeight = 0;
+            glfwGetWindowSize(window, &windowWidth, &windowHeight);
+            float ndcX = 2.0f * float(pickX) / float(std::max(windowWidth, 1)) - 1.0f;
+            float ndcY = 1.0f - 2.0f * float(pickY) / float(std::max(windowHeight, 1));
+            glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+            glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+            glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+            pickOrigin = glm::vec3(nearPoint) / nearPoint.w;
+            pickDirection = glm::vec3(farPoint) / farPoint.w - pickOrigin;
+        }
 
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        for (const SceneModel& entry : scene) {
+            if (entry.failed) continue;
+
+            // The model once its coarsest level is in, before that the
+            // preview, before that the placeholder.
+            bool showModel = entry.ready && entry.gpuMesh.drawable();
+            bool showPreview = !showModel && entry.preview.VAO != 0;
+            glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), entry.slot);
+            if (showModel || showPreview) {
+                modelMatrix = glm::rotate(modelMatrix, glm::radians(modelPitch), glm::vec3(1.0f, 0.0f, 0.0f));
+                modelMatrix = glm::rotate(modelMatrix, glm::radians(modelYaw), glm::vec3(0.0f, 1.0f, 0.0f));
+                modelMatrix = modelMatrix * entry.placement;
+            }
+            else {
+                // Spin the placeholder so a busy load still reads as alive.
+                modelMatrix = glm::rotate(modelMatrix, currentFrame * 1.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+            }
+            const GpuMesh& gpuMesh = showModel ? entry.gpuMesh : showPreview ? entry.preview : placeholder;
+
+            if (picking && entry.ready) {
+                // The ray parameter survives the affine map, so the nearest
+                // hit over all models is simply the smallest one.
+                auto pickBegin = std::chrono::steady_clock::now();
+                glm::mat4 worldToMesh = glm::inverse(modelMatrix);
+                MeshHit hit;
+                if (raycastMesh(entry.load->mesh(), glm::vec3(worldToMesh * glm::vec4(pickOrigin, 1.0f)),
+                                glm::vec3(worldToMesh * glm::vec4(pickDirection, 0.0f)), hit, pickDistance)) {
+                    pickDistance = hit.distance;
+                    pickedModel = &entry;
+                    pickedHit = hit;
+                    pickedPosition = pickOrigin + hit.distance * pickDirection;
+                }
+                pickMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pickBegin).count();
+            }
+            // Quantized positions are dequantized by the model matrix; the
+            // normals are decoded in the shader and use the plain matrix.
+            toonShader.setMat4("model", modelMatrix * gpuMesh.positionTransform);
+            toonShader.setBool("octahedralNormals", gpuMesh.octahedralNormals);
+
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
+            toonShader.setMat3("normalMatrix", normalMatrix);
+
+            // Pick the level whose error stays under a pixel at the bounding
+            // sphere's projected size; placement scales uniformly.
+            glm::vec3 sphereCenter = glm::vec3(modelMatrix * glm::vec4(gpuMesh.sphereCenter, 1.0f));
+            float sphereRadius = gpuMesh.sphereRadius * glm::length(glm::vec3(modelMatrix[0]));
+            float distance = glm::length(sphereCenter - cameraPos);
+            size_t lod = 0;
+            if (distance > sphereRadius) {
+                float projectedRadius = sphereRadius / (distance * std::tan(glm::radians(fov) * 0.5f)) * (0.5f * SCR_HEIGHT);
+                lod = selectLod(gpuMesh.lods, projectedRadius);
+            }
+            lod = std::max(lod, gpuMesh.finestLevel);
+
+            // One multi-draw per material; parts and meshlets outside the view
+            // (or, with back-face culling, facing away) are skipped.
+            glm::mat4 modelViewProjection = projection * view * modelMatrix;
+            MeshletCuller culler(modelViewProjection, glm::vec3(glm::inverse(modelMatrix) * glm::vec4(cameraPos, 1.0f)));
+            std::function<bool(const Meshlet&)> isMeshletVisible;
+            if (meshletCulling && backFaceCulling) {
+                isMeshletVisible = [&culler](const Meshlet& meshlet) { return culler.isVisible(meshlet); };
+            }
+            else if (meshletCulling) {
+                isMeshletVisible = [&culler](const Meshlet& meshlet) { return culler.isInFrustum(meshlet.center, meshlet.radius); };
+            }
+            drawnIndices += drawSubmeshes(gpuMesh,
+                [&](int materialId) {
+                    bool known = materialId >= 0 && size_t(materialId) < gpuMesh.materials.size();
+                    toonShader.setVec3("objectColor", known ? gpuMesh.materials[materialId].diffuse : defaultObjectColor);
+                },
+                [&](const Submesh& submesh) {
+                    return boxInFrustum(modelViewProjection, submesh.boundsMin, submesh.boundsMax);
+                },
+                lod, isMeshletVisible);
+
+            // Clusters whose normal cone faces all one way are settled
+            // without testing their edges, so this scales with the outline
+            // rather than the triangle count. The lines follow the full
+            // resolution; any LOD drawn stays within a pixel of it.
+            if (outlines && showModel) {
+                outlineLines.clear();
+                outlineEdges += extractOutlines(entry.load->mesh(), culler, outlineLines);
+                if (!outlineLines.empty()) {
+                    outlineShader.use();
+                    outlineShader.setMat4("projection", projection);
+                    outlineShader.setMat4("view", view);
+                    outlineShader.setMat4("model", modelMatrix * gpuMesh.positionTransform);
+                    outlineShader.setMat3("normalMatrix", normalMatrix);
+                    outlineShader.setBool("octahedralNormals", gpuMesh.octahedralNormals);
+                    outlineShader.setVec3("outlineColor", glm::vec3(0.05f, 0.05f, 0.08f));
+                    drawOutlines(gpuMesh, outlineLines);
+                    toonShader.use();
+                }
+            }
+        }
+
+        if (picking) {
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(3);
+            if (pickedModel) {
+                line << "Picked triangle " << pickedHit.triangle << " (nearest vertex " << pickedHit.vertex << ") of '"
+                     << pickedModel->load->path() << "' at (" << pickedPosition.x << ", " << pickedPosition.y << ", "
+                     << pickedPosition.z << ")";
+            }
+            else {
+                line << "Picked nothing";
+            }
+            line << std::setprecision(1) << " in " << 1000.0 * pickMs << " us.";
+            std::cout << line.str() << std::endl;
+        }
+
+        if (measureFrame) {
+            glEndQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB);
+            statisticsPending = true;
+        }
+        if (pendingModels == 0 && currentFrame - lastTitleUpdate > 0.25) {
+            lastTitleUpdate = currentFrame;
+            std::string title = "Toon Shading OBJ Example - " + std::to_string(drawnIndices / 3) + " triangles";
+            if (statisticsQuery != 0) title += ", " + std::to_string(vertexInvocations) + " vertex shader invocations";
+            title += std::string(", meshlet culling ") + (meshletCulling ? "on" : "off") + " (C)";
+            title += std::string(", back-face culling ") + (backFaceCulling ? "on" : "off") + " (B)";
+            title += outlines ? ", " + std::to_string(outlineEdges) + " outline edges (O)" : std::string(", outlines off (O)");
+            glfwSetWindowTitle(window, title.c_str());
+        }
 
 
         glfwSwapBuffers(window);
         glfwPollEvents();
 
+        if (!firstFramePresented) {
+            firstFramePresented = true;
+            double startupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count();
+            std::cout << "Startup to first frame: " << startupMs << " ms ("
+                << (pendingModels == 0 ? "models" : "placeholders") << ")." << std::endl;
+        }
+
         // --- JR's Camera System --- (Now integrated above before rendering)
         /*
         // --- OLD CODE ---
@@ -232,107 +539,67 @@ int main(int argc, char* argv[]) {
         */
     }
 
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    for (SceneModel& entry : scene) {
+        entry.upload.reset();
+        destroyMesh(entry.gpuMesh);
+        destroyMesh(entry.preview);
+    }
+    if (statisticsQuery != 0) glDeleteQueries(1, &statisticsQuery);
+    destroyMesh(placeholder);
 
     glfwTerminate();
-    return 0;
+    return exitCode;
 }
 
 
-bool loadObjModel(const std::string& filepath, MeshData& meshData) {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials; 
-    std::string warn, err;
+// Lays several models out on a centred grid facing the camera; a single
+// model stays at the origin.
+glm::vec3 sceneSlotPosition(size_t index, size_t count) {
+    if (count <= 1) return glm::vec3(0.0f);
+    size_t columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    size_t rows = (count + columns - 1) / columns;
+    float column = static_cast<float>(index % columns) - 0.5f * static_cast<float>(columns - 1);
+    float row = static_cast<float>(index / columns) - 0.5f * static_cast<float>(rows - 1);
+    return glm::vec3(column * SCENE_SLOT_SPACING, -row * SCENE_SLOT_SPACING, 0.0f);
+}
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) {
-        if (!err.empty()) {
-            std::cerr << "TinyObjLoader Error: " << err << std::endl;
-        }
-        return false;
-    }
+glm::mat4 scenePlacement(const MeshData& mesh, size_t sceneSize) {
+    glm::mat4 placement = glm::mat4(1.0f);
+    if (sceneSize <= 1) {
+        placement = glm::scale(placement, glm::vec3(50.5f, 50.5f, 50.5f)); 
 
-    if (!warn.empty()) {
-        std::cout << "TinyObjLoader Warning: " << warn << std::endl;
+        placement = glm::translate(placement, glm::vec3(0.0f, -0.25f, 0.0f));
+        return placement;
     }
+    // Models come in arbitrary units, so fit each one's bounds into a slot.
+    glm::vec3 extent = mesh.boundsMax - mesh.boundsMin;
+    float largest = std::max(extent.x, std::max(extent.y, extent.z));
+    float scale = (largest > 0.0f) ? SCENE_SLOT_SIZE / largest : 1.0f;
+    placement = glm::scale(placement, glm::vec3(scale));
+    placement = glm::translate(placement, -0.5f * (mesh.boundsMin + mesh.boundsMax));
+    return placement;
+}
 
-    meshData.vertices.clear();
-    meshData.indices.clear();
-    std::unordered_map<std::string, unsigned int> uniqueVertices{};
-
-    for (const auto& shape : shapes) {
-        size_t index_offset = 0;
-        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); ++f) {
-            int fv = shape.mesh.num_face_vertices[f];
-            if (fv != 3) {
-                std::cerr << "Warning: TinyObjLoader found a non-triangle face (vertices=" << fv << "). Skipping." << std::endl;
-                index_offset += fv;
-                continue;
-            }
-
-
-            for (size_t v = 0; v < fv; ++v) {
-                tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
-
-                std::string vertexKey = std::to_string(idx.vertex_index) + "/";
-                if (idx.normal_index >= 0) vertexKey += std::to_string(idx.normal_index); else vertexKey += "-1";
-
-                if (uniqueVertices.count(vertexKey) == 0) {
-                    Vertex newVertex;
-
-                    if (idx.vertex_index < 0 || 3 * size_t(idx.vertex_index) + 2 >= attrib.vertices.size()) {
-                        throw std::runtime_error("Invalid vertex index in OBJ file.");
-                    }
-                    newVertex.Position = {
-                        attrib.vertices[3 * size_t(idx.vertex_index) + 0],
-                        attrib.vertices[3 * size_t(idx.vertex_index) + 1],
-                        attrib.vertices[3 * size_t(idx.vertex_index) + 2]
-                    };
-
-                    if (idx.normal_index >= 0 && 3 * size_t(idx.normal_index) + 2 < attrib.normals.size()) {
-                        newVertex.Normal = {
-                            attrib.normals[3 * size_t(idx.normal_index) + 0],
-                            attrib.normals[3 * size_t(idx.normal_index) + 1],
-                            attrib.normals[3 * size_t(idx.normal_index) + 2]
-                        };
-                    }
-                    else {
-                        std::cerr << "Warning: Missing or invalid normal index for vertex. Using placeholder (0,1,0)." << std::endl;
-                        newVertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
-                    }
-
-                    // Texture Coordinates
-                    // if (idx.texcoord_index >= 0 && 2 * idx.texcoord_index + 1 < attrib.texcoords.size()) {
-                    //     newVertex.TexCoords = {
-                    //         attrib.texcoords[2 * idx.texcoord_index + 0],
-                    //         attrib.texcoords[2 * idx.texcoord_index + 1]
-                    //     };
-                    // } else {
-                    //     newVertex.TexCoords = glm::vec2(0.0f, 0.0f);
-                    // }
-
-                    meshData.vertices.push_back(newVertex);
-                    uniqueVertices[vertexKey] = static_cast<unsigned int>(meshData.vertices.size() - 1);
-                }
-                meshData.indices.push_back(uniqueVertices[vertexKey]);
-            }
-            index_offset += fv;
+// Conservative: false only when all eight corners are outside the same clip
+// plane.
+bool boxInFrustum(const glm::mat4& modelViewProjection, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    int outside[6] = { 0, 0, 0, 0, 0, 0 };
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec4 p = modelViewProjection * glm::vec4(
+            (corner & 1) ? boxMax.x : boxMin.x,
+            (corner & 2) ? boxMax.y : boxMin.y,
+            (corner & 4) ? boxMax.z : boxMin.z, 1.0f);
+        for (int axis = 0; axis < 3; ++axis) {
+            if (p[axis] < -p.w) ++outside[2 * axis];
+            if (p[axis] > p.w) ++outside[2 * axis + 1];
         }
     }
-
-    if (meshData.vertices.empty() || meshData.indices.empty()) {
-        std::cerr << "Warning: Loaded OBJ file resulted in empty mesh data." << std::endl;
-
+    for (int plane = 0; plane < 6; ++plane) {
+        if (outside[plane] == 8) return false;
     }
-
-    return true; 
+    return true;
 }
 
-
-
-
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
 }
@@ -341,6 +608,17 @@ void processInput(GLFWwindow* window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    bool cullingKey = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+    if (cullingKey && !cullingKeyDown) meshletCulling = !meshletCulling;
+    cullingKeyDown = cullingKey;
+
+    bool backFaceKey = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+    if (backFaceKey && !backFaceKeyDown) backFaceCulling = !backFaceCulling;
+    backFaceKeyDown = backFaceKey;
+
+    bool outlineKey = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+    if (outlineKey && !outlineKeyDown) outlines = !outlines;
+    outlineKeyDown = outlineKey;
 
 }
 
@@ -355,6 +633,10 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
             mouseButtonPressed = false;
         }
     }
+    else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
+        glfwGetCursorPos(window, &pickX, &pickY);
+        pickRequested = true;
+    }
 }
 
 
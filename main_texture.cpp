@@ -7,9 +7,12 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include <unordered_map>
 #include <stdexcept>
 #include <cmath>
+#include <algorithm>
+
+#include "obj_vertices.h"
+#include "vertex_format_gl.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
@@ -43,11 +46,7 @@ float lastFrame = 0.0f;
 
 bool mouseButtonPressed = false;
 
-struct Vertex {
-	glm::vec3 Position;
-	glm::vec3 Normal;
-	glm::vec2 TexCoords;
-};
+typedef PackedVertex<PositionAttribute, NormalAttribute, TexCoordAttribute> Vertex;
 
 struct MeshData {
 	std::vector<Vertex>       vertices;
@@ -161,12 +160,7 @@ int main(int argc, char* argv[]) {
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), &mesh.indices[0], GL_STATIC_DRAW);
 	
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Position));
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-	glEnableVertexAttribArray(2);
+	setVertexAttributes<Vertex>();
 	
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -250,91 +244,12 @@ int main(int argc, char* argv[]) {
 
 
 bool loadObjModel(const std::string& filepath, MeshData& meshData) {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, err;
-	
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) {
-		if (!err.empty()) {
-			std::cerr << "TinyObjLoader Error: " << err << std::endl;
-		}
-		return false;
+	if (!loadObjVertices(filepath, meshData.vertices, meshData.indices)) return false;
+	size_t missing = replaceMissingNormals(meshData.vertices, glm::vec3(0.0f, 1.0f, 0.0f));
+	if (missing > 0) {
+		std::cerr << "Warning: " << missing << " vertices have no normal. Using placeholder (0,1,0)." << std::endl;
 	}
-	
-	if (!warn.empty()) {
-		std::cout << "TinyObjLoader Warning: " << warn << std::endl;
-	}
-	
-	meshData.vertices.clear();
-	meshData.indices.clear();
-	std::unordered_map<std::string, unsigned int> uniqueVertices{};
-	
-	for (const auto& shape : shapes) {
-		size_t index_offset = 0;
-		for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); ++f) {
-			int fv = shape.mesh.num_face_vertices[f];
-			if (fv != 3) {
-				std::cerr << "Warning: TinyObjLoader found a non-triangle face (vertices=" << fv << "). Skipping." << std::endl;
-				index_offset += fv;
-				continue;
-			}
-			
-			
-			for (size_t v = 0; v < fv; ++v) {
-				tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
-				
-				std::string vertexKey = std::to_string(idx.vertex_index) + "/";
-				if (idx.normal_index >= 0) vertexKey += std::to_string(idx.normal_index); else vertexKey += "-1";
-				if (idx.texcoord_index >= 0) vertexKey += "/" + std::to_string(idx.texcoord_index); else vertexKey += "/-1"; // Add if using texcoords
-				if (idx.texcoord_index >= 0) vertexKey += "/" + std::to_string(idx.texcoord_index); else vertexKey += "/-1"; // Add if using texcoords
-				
-				if (uniqueVertices.count(vertexKey) == 0) {
-					Vertex newVertex;
-					
-					if (idx.vertex_index < 0 || 3 * idx.vertex_index + 2 >= attrib.vertices.size()) {
-						throw std::runtime_error("Invalid vertex index in OBJ file.");
-					}
-					newVertex.Position = {
-						attrib.vertices[3 * idx.vertex_index + 0],
-						attrib.vertices[3 * idx.vertex_index + 1],
-						attrib.vertices[3 * idx.vertex_index + 2]
-					};
-					
-					if (idx.normal_index >= 0 && 3 * idx.normal_index + 2 < attrib.normals.size()) {
-						newVertex.Normal = glm::normalize(glm::vec3{
-							attrib.normals[3 * idx.normal_index + 0],
-							attrib.normals[3 * idx.normal_index + 1],
-							attrib.normals[3 * idx.normal_index + 2]
-						});
-					} else {
-						std::cerr << "Warning: Missing or invalid normal index for vertex. Using placeholder (0,1,0)." << std::endl;
-						newVertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
-					}
-					
-					if (idx.texcoord_index >= 0 && 2 * idx.texcoord_index + 1 < attrib.texcoords.size()) {
-						newVertex.TexCoords = {
-							attrib.texcoords[2 * idx.texcoord_index + 0],
-							attrib.texcoords[2 * idx.texcoord_index + 1]
-						};
-					} else {
-						newVertex.TexCoords = glm::vec2(0.0f, 0.0f);
-					}
-					
-					meshData.vertices.push_back(newVertex);
-					uniqueVertices[vertexKey] = static_cast<unsigned int>(meshData.vertices.size() - 1);
-				}
-				meshData.indices.push_back(uniqueVertices[vertexKey]);
-			}
-			index_offset += fv;
-		}
-	}
-	
-	if (meshData.vertices.empty() || meshData.indices.empty()) {
-		std::cerr << "Warning: Loaded OBJ file resulted in empty mesh data." << std::endl;
-		return false;
-	}
-	
+	normalizeNormals(meshData.vertices);
 	return true;
 }
 
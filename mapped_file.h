@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file (mmap on POSIX, a file mapping
+// view on Windows). The mapping stays valid until close() or destruction.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // sequential hints the OS to read ahead aggressively and drop pages
+    // behind the reader (madvise(MADV_SEQUENTIAL) / FILE_FLAG_SEQUENTIAL_SCAN).
+    bool open(const std::string& path, bool sequential = false);
+    void close();
+
+    bool isOpen() const { return mapped != nullptr; }
+    const unsigned char* data() const { return static_cast<const unsigned char*>(mapped); }
+    size_t size() const { return length; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    void* mapped;
+    size_t length;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+};
+
+#endif
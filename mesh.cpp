@@ -0,0 +1,736 @@
+#include "mesh.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <stdexcept>
+
+#include "bvh.h"
+#include "gltf_loader.h"
+#include "index_chunks.h"
+#include "inflate_stream.h"
+#include "lod.h"
+#include "mesh_cache.h"
+#include "mesh_preview.h"
+#include "meshlet.h"
+#include "normal_gen.h"
+#include "obj_parser.h"
+#include "outline.h"
+#include "ply_loader.h"
+#include "position_weld.h"
+#include "overdraw.h"
+#include "submesh.h"
+#include "vertex_cache.h"
+#include "vertex_fetch.h"
+#include "vertex_dedup.h"
+
+// Must come after every header that pulls in tiny_obj_loader.h.
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+
+void MeshData::computeBounds() {
+    size_t count = vertexCount();
+    if (count == 0) {
+        boundsMin = boundsMax = glm::vec3(0.0f);
+        return;
+    }
+    const Vertex* data = vertexData();
+    boundsMin = boundsMax = data[0].Position;
+    for (size_t i = 1; i < count; ++i) {
+        boundsMin = glm::min(boundsMin, data[i].Position);
+        boundsMax = glm::max(boundsMax, data[i].Position);
+    }
+}
+
+void MeshData::clear() {
+    vertices.clear();
+    indices.clear();
+    submeshes.clear();
+    materials.clear();
+    shortIndices.clear();
+    indexChunks.clear();
+    chunkVertices.clear();
+    lods.clear();
+    lodSubmeshes.clear();
+    meshlets.clear();
+    bvh.clear();
+    bvhTriangles.clear();
+    edges.clear();
+    edgeClusters.clear();
+    mapping.reset();
+    mappedVertices = nullptr;
+    mappedIndices = nullptr;
+    mappedVertexCount = 0;
+    mappedIndexCount = 0;
+    fromCache = false;
+}
+
+// Runs normal generation if any vertex came without a normal and reports
+// the result once.
+static void fillMissingNormals(MeshData& meshData, const NormalGenOptions& options,
+                               const std::vector<unsigned int>& smoothingGroups) {
+    auto begin = std::chrono::steady_clock::now();
+    NormalGenStats stats = generateNormals(meshData, options, smoothingGroups);
+    if (stats.generated == 0) return;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "Generated normals for " << stats.generated << " of "
+              << meshData.vertices.size() - stats.splitVertices << " vertices";
+    if (stats.splitVertices > 0) std::cout << " (" << stats.splitVertices << " extra vertices at creases)";
+    std::cout << " in " << ms << " ms." << std::endl;
+}
+
+static void copyMaterials(const tinyobj::material_t* materials, size_t count, MeshData& meshData) {
+    meshData.materials.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        meshData.materials[i].diffuse = glm::vec3(materials[i].diffuse[0], materials[i].diffuse[1], materials[i].diffuse[2]);
+    }
+}
+
+// tinyobj's LoadObj, reading a gzip-compressed OBJ through the inflater a
+// chunk at a time.
+static bool loadGzipObjSerial(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+                              std::vector<tinyobj::material_t>* materials, std::string* warn, std::string* err,
+                              const MappedFile& file, const std::string& filepath) {
+    InflateStream inflater(file.data(), file.size(), InflateStream::GZIP);
+    InflateStreamBuf buffer(inflater);
+    std::istream stream(&buffer);
+    tinyobj::MaterialFileReader materialReader(objMaterialDir(filepath));
+    bool parsed = tinyobj::LoadObj(attrib, shapes, materials, warn, err, &stream, &materialReader);
+    if (inflater.error()) {
+        (*err) += std::string("Cannot decompress OBJ: ") + inflater.error() + "\n";
+        return false;
+    }
+    return parsed;
+}
+
+static bool parseObjModel(const std::string& filepath, MeshData& meshData, const MeshLoadOptions& options) {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials; 
+    std::string warn, err;
+
+    bool parsed;
+    if (options.parseThreads == 1) {
+        MappedFile file;
+        bool gzipped = file.open(filepath, true) && InflateStream::hasGzipMagic(file.data(), file.size());
+        parsed = gzipped ? loadGzipObjSerial(&attrib, &shapes, &materials, &warn, &err, file, filepath)
+                         : tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str(),
+                                            objMaterialDir(filepath).c_str());
+    }
+    else {
+        parsed = loadObjParallel(&attrib, &shapes, &materials, &warn, &err, filepath.c_str(), options.parseThreads,
+                                 options.mapInput);
+    }
+    if (!parsed) {
+        if (!err.empty()) {
+            std::cerr << "TinyObjLoader Error: " << err << std::endl;
+        }
+        return false;
+    }
+
+    if (!warn.empty()) {
+        std::cout << "TinyObjLoader Warning: " << warn << std::endl;
+    }
+
+    // Welded positions share one index, so the tuple dedup below merges
+    // seam-split corners as long as their normals agree.
+    std::vector<int> positionRemap;
+    bool weld = options.weldTolerance > 0.0f;
+    if (weld) {
+        auto begin = std::chrono::steady_clock::now();
+        PositionWeldStats stats = weldPositions(attrib.vertices, options.weldTolerance, positionRemap);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << "Welded " << stats.welded << " of " << stats.positions << " positions in " << ms << " ms." << std::endl;
+    }
+
+    size_t cornerCount = 0;
+    for (const auto& shape : shapes) cornerCount += shape.mesh.indices.size();
+    // Unique corners are bounded by the index count, and in practice by the
+    // largest attribute array, so size the table from the smaller of the two.
+    size_t attribCount = std::max(attrib.vertices.size() / 3, attrib.normals.size() / 3);
+    VertexDedupTable uniqueVertices(std::min(cornerCount, attribCount));
+
+    meshData.clear();
+    meshData.vertices.reserve(std::min(cornerCount, attribCount));
+    meshData.indices.reserve(cornerCount);
+
+    std::vector<unsigned int> smoothingGroups;
+    bool collectGroups = options.normals.useSmoothingGroups;
+    // One entry per emitted triangle, for buildSubmeshes().
+    std::vector<unsigned int> triangleParts;
+    std::vector<int> triangleMaterials;
+    triangleParts.reserve(cornerCount / 3);
+    triangleMaterials.reserve(cornerCount / 3);
+    const ObjArrays<tinyobj::real_t> arrays = { attrib.vertices, attrib.normals, attrib.texcoords };
+
+    for (size_t s = 0; s < shapes.size(); ++s) {
+        const tinyobj::shape_t& shape = shapes[s];
+        size_t index_offset = 0;
+        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); ++f) {
+            int fv = shape.mesh.num_face_vertices[f];
+            if (fv != 3) {
+                std::cerr << "Warning: TinyObjLoader found a non-triangle face (vertices=" << fv << "). Skipping." << std::endl;
+                index_offset += fv;
+                continue;
+            }
+            if (collectGroups) {
+                smoothingGroups.push_back(f < shape.mesh.smoothing_group_ids.size() ? shape.mesh.smoothing_group_ids[f] : 0);
+            }
+            int materialId = f < shape.mesh.material_ids.size() ? shape.mesh.material_ids[f] : -1;
+            triangleParts.push_back(static_cast<unsigned int>(s));
+            triangleMaterials.push_back(materialId >= 0 && size_t(materialId) < materials.size() ? materialId : -1);
+
+            for (size_t v = 0; v < fv; ++v) {
+                tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
+                if (weld && idx.vertex_index >= 0 && size_t(idx.vertex_index) < positionRemap.size()) {
+                    idx.vertex_index = positionRemap[idx.vertex_index];
+                }
+
+                tinyobj::index_t key = Vertex::dedupKey(idx);
+                bool inserted;
+                unsigned int vertexIndex = uniqueVertices.findOrInsert(
+                    key.vertex_index, key.normal_index, key.texcoord_index,
+                    static_cast<unsigned int>(meshData.vertices.size()), inserted);
+
+                if (inserted) {
+                    meshData.vertices.push_back(Vertex::fromObj(arrays, idx));
+                }
+                meshData.indices.push_back(vertexIndex);
+            }
+            index_offset += fv;
+        }
+    }
+
+    fillMissingNormals(meshData, options.normals, smoothingGroups);
+    copyMaterials(materials.data(), materials.size(), meshData);
+    buildSubmeshes(meshData, triangleParts, triangleMaterials);
+
+    if (meshData.vertices.empty() || meshData.indices.empty()) {
+        std::cerr << "Warning: Loaded OBJ file resulted in empty mesh data." << std::endl;
+
+    }
+
+    return true; 
+}
+
+namespace {
+
+// Read-only streambuf over an existing byte range, so tinyobj's istream-based
+// callback parser can read a mapped file without copying it.
+class ByteRangeBuf : public std::streambuf {
+public:
+    ByteRangeBuf(const char* data, size_t size) {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+};
+
+struct StreamingBuilder {
+    MeshData* meshData;
+    std::vector<tinyobj::real_t> positions;
+    std::vector<tinyobj::real_t> normals;
+    // Never filled: the streaming callbacks skip texture coordinates, which
+    // Vertex has no member for.
+    std::vector<tinyobj::real_t> texcoords;
+    VertexDedupTable uniqueVertices;
+    // Parts are cut at g/o records, like the shapes of the other loaders.
+    unsigned int part;
+    int materialId;
+    std::vector<unsigned int> triangleParts;
+    std::vector<int> triangleMaterials;
+
+    explicit StreamingBuilder(size_t expectedVertices)
+        : meshData(nullptr), uniqueVertices(expectedVertices), part(0), materialId(-1) {}
+
+    void addTriangles(size_t count) {
+        triangleParts.insert(triangleParts.end(), count, part);
+        triangleMaterials.insert(triangleMaterials.end(), count, materialId);
+    }
+
+    void emit(const tinyobj::index_t& idx) {
+        tinyobj::index_t key = Vertex::dedupKey(idx);
+        bool inserted;
+        unsigned int vertexIndex = uniqueVertices.findOrInsert(
+            key.vertex_index, key.normal_index, key.texcoord_index,
+            static_cast<unsigned int>(meshData->vertices.size()), inserted);
+        if (inserted) {
+            const ObjArrays<tinyobj::real_t> arrays = { positions, normals, texcoords };
+            meshData->vertices.push_back(Vertex::fromObj(arrays, idx));
+        }
+        meshData->indices.push_back(vertexIndex);
+    }
+};
+
+// OBJ indices are 1-based, negative values count back from the last element
+// read so far, and the callback API passes 0 for a missing index.
+int resolveObjIndex(int raw, size_t count) {
+    if (raw > 0) return raw - 1;
+    if (raw < 0) return (size_t(-raw) <= count) ? int(count) + raw : -1;
+    return -1;
+}
+
+void streamVertex(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t) {
+    StreamingBuilder* builder = static_cast<StreamingBuilder*>(user);
+    builder->positions.push_back(x);
+    builder->positions.push_back(y);
+    builder->positions.push_back(z);
+}
+
+void streamNormal(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z) {
+    StreamingBuilder* builder = static_cast<StreamingBuilder*>(user);
+    builder->normals.push_back(x);
+    builder->normals.push_back(y);
+    builder->normals.push_back(z);
+}
+
+void streamFace(void* user, tinyobj::index_t* corners, int count) {
+    StreamingBuilder* builder = static_cast<StreamingBuilder*>(user);
+    if (count < 3) return;
+
+    // Faces may only reference vertices defined above them; that is what
+    // lets each face be emitted immediately.
+    size_t vertexCount = builder->positions.size() / 3;
+    size_t normalCount = builder->normals.size() / 3;
+    for (int i = 0; i < count; ++i) {
+        corners[i].vertex_index = resolveObjIndex(corners[i].vertex_index, vertexCount);
+        corners[i].normal_index = resolveObjIndex(corners[i].normal_index, normalCount);
+        corners[i].texcoord_index = -1;
+        if (corners[i].vertex_index < 0 || size_t(corners[i].vertex_index) >= vertexCount) {
+            throw std::runtime_error("Invalid vertex index in OBJ file.");
+        }
+    }
+
+    if (count == 4) {
+        // Split along the shorter diagonal, like tinyobj.
+        const tinyobj::real_t* v0 = &builder->positions[3 * size_t(corners[0].vertex_index)];
+        const tinyobj::real_t* v1 = &builder->positions[3 * size_t(corners[1].vertex_index)];
+        const tinyobj::real_t* v2 = &builder->positions[3 * size_t(corners[2].vertex_index)];
+        const tinyobj::real_t* v3 = &builder->positions[3 * size_t(corners[3].vertex_index)];
+        tinyobj::real_t e02x = v2[0] - v0[0], e02y = v2[1] - v0[1], e02z = v2[2] - v0[2];
+        tinyobj::real_t e13x = v3[0] - v1[0], e13y = v3[1] - v1[1], e13z = v3[2] - v1[2];
+        tinyobj::real_t sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+        tinyobj::real_t sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+        const int split[2][6] = { { 0, 1, 2, 0, 2, 3 }, { 0, 1, 3, 1, 2, 3 } };
+        const int* order = split[sqr02 < sqr13 ? 0 : 1];
+        for (int k = 0; k < 6; ++k) builder->emit(corners[order[k]]);
+        builder->addTriangles(2);
+        return;
+    }
+    for (int k = 1; k + 1 < count; ++k) {
+        builder->emit(corners[0]);
+        builder->emit(corners[k]);
+        builder->emit(corners[k + 1]);
+    }
+    builder->addTriangles(size_t(count - 2));
+}
+
+void streamMaterialLibrary(void* user, const tinyobj::material_t* materials, int count) {
+    StreamingBuilder* builder = static_cast<StreamingBuilder*>(user);
+    copyMaterials(materials, size_t(count), *builder->meshData);
+}
+
+void streamUseMaterial(void* user, const char*, int materialId) {
+    StreamingBuilder* builder = static_cast<StreamingBuilder*>(user);
+    builder->materialId = (materialId >= 0 && size_t(materialId) < builder->meshData->materials.size()) ? materialId : -1;
+}
+
+void streamGroup(void* user, const char**, int) {
+    ++static_cast<StreamingBuilder*>(user)->part;
+}
+
+void streamObject(void* user, const char*) {
+    ++static_cast<StreamingBuilder*>(user)->part;
+}
+
+struct ObjRecordCounts {
+    size_t positions = 0;
+    size_t normals = 0;
+    size_t faces = 0;
+};
+
+// One memchr pass over the mapped file to size the output arrays exactly, so
+// they never reallocate (and briefly double) while streaming.
+ObjRecordCounts countObjRecords(const char* data, size_t size) {
+    ObjRecordCounts counts;
+    const char* end = data + size;
+    for (const char* line = data; line < end;) {
+        while (line < end && (*line == ' ' || *line == '\t')) ++line;
+        if (end - line >= 2 && line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) ++counts.positions;
+        else if (end - line >= 3 && line[0] == 'v' && line[1] == 'n' && (line[2] == ' ' || line[2] == '\t')) ++counts.normals;
+        else if (end - line >= 2 && line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) ++counts.faces;
+        const char* next = static_cast<const char*>(std::memchr(line, '\n', size_t(end - line)));
+        line = next ? next + 1 : end;
+    }
+    return counts;
+}
+
+}  // namespace
+
+// Builds MeshData straight from tinyobj's callback parser. Only the position
+// and normal arrays are kept besides the output, instead of a full attrib_t
+// plus per-shape index lists.
+static bool streamObjModel(const std::string& filepath, MeshData& meshData, const NormalGenOptions& normalOptions) {
+    MappedFile file;
+    ObjRecordCounts counts;
+    bool mapped = file.open(filepath, true);
+    // Compressed input is inflated as the parser reads it, so there is no
+    // text to pre-count and the arrays grow as usual.
+    bool gzipped = mapped && InflateStream::hasGzipMagic(file.data(), file.size());
+    if (mapped && !gzipped) {
+        counts = countObjRecords(reinterpret_cast<const char*>(file.data()), file.size());
+    }
+
+    size_t expectedVertices = std::min(3 * counts.faces, std::max(counts.positions, counts.normals));
+    StreamingBuilder builder(expectedVertices);
+    builder.meshData = &meshData;
+    builder.positions.reserve(3 * counts.positions);
+    builder.normals.reserve(3 * counts.normals);
+
+    meshData.clear();
+    meshData.vertices.reserve(expectedVertices);
+    meshData.indices.reserve(3 * counts.faces);
+
+    tinyobj::callback_t callbacks;
+    callbacks.vertex_cb = streamVertex;
+    callbacks.normal_cb = streamNormal;
+    callbacks.index_cb = streamFace;
+    callbacks.usemtl_cb = streamUseMaterial;
+    callbacks.mtllib_cb = streamMaterialLibrary;
+    callbacks.group_cb = streamGroup;
+    callbacks.object_cb = streamObject;
+    // Same .mtl lookup as the other loaders.
+    tinyobj::MaterialFileReader materialReader(objMaterialDir(filepath));
+
+    std::string warn, err;
+    bool parsed;
+    if (gzipped) {
+        InflateStream inflater(file.data(), file.size(), InflateStream::GZIP);
+        InflateStreamBuf buffer(inflater);
+        std::istream stream(&buffer);
+        parsed = tinyobj::LoadObjWithCallback(stream, callbacks, &builder, &materialReader, &warn, &err);
+        if (inflater.error()) {
+            err += std::string("Cannot decompress OBJ: ") + inflater.error();
+            parsed = false;
+        }
+    }
+    else if (mapped) {
+        ByteRangeBuf buffer(reinterpret_cast<const char*>(file.data()), file.size());
+        std::istream stream(&buffer);
+        parsed = tinyobj::LoadObjWithCallback(stream, callbacks, &builder, &materialReader, &warn, &err);
+    }
+    else {
+        std::ifstream stream(filepath, std::ios::in | std::ios::binary);
+        if (!stream) {
+            std::cerr << "TinyObjLoader Error: Cannot open file [" << filepath << "]" << std::endl;
+            return false;
+        }
+        parsed = tinyobj::LoadObjWithCallback(stream, callbacks, &builder, &materialReader, &warn, &err);
+    }
+    if (!parsed) {
+        if (!err.empty()) {
+            std::cerr << "TinyObjLoader Error: " << err << std::endl;
+        }
+        return false;
+    }
+
+    if (!warn.empty()) {
+        std::cout << "TinyObjLoader Warning: " << warn << std::endl;
+    }
+
+    fillMissingNormals(meshData, normalOptions, std::vector<unsigned int>());
+    buildSubmeshes(meshData, builder.triangleParts, builder.triangleMaterials);
+
+    if (meshData.vertices.empty() || meshData.indices.empty()) {
+        std::cerr << "Warning: Loaded OBJ file resulted in empty mesh data." << std::endl;
+    }
+
+    return true;
+}
+
+// The optimizers rewrite the arrays in place, so mapped ones (.glb) are
+// copied out first.
+static void unmapIndices(MeshData& meshData) {
+    if (!meshData.mappedIndices) return;
+    meshData.indices.assign(meshData.mappedIndices, meshData.mappedIndices + meshData.mappedIndexCount);
+    meshData.mappedIndices = nullptr;
+    meshData.mappedIndexCount = 0;
+    if (!meshData.mappedVertices) meshData.mapping.reset();
+}
+
+static void unmapVertices(MeshData& meshData) {
+    if (!meshData.mappedVertices) return;
+    meshData.vertices.assign(meshData.mappedVertices, meshData.mappedVertices + meshData.mappedVertexCount);
+    meshData.mappedVertices = nullptr;
+    meshData.mappedVertexCount = 0;
+    if (!meshData.mappedIndices) meshData.mapping.reset();
+}
+
+// Triangle reordering passes of optimizeMesh.
+// Returns whether the triangles were left in an overdraw order.
+static bool optimizeTriangleOrder(MeshData& meshData, const MeshLoadOptions& options) {
+    bool overdraw = options.overdrawThreshold > 0.0f;
+    if (!(options.optimizeVertexCache || overdraw)) return false;
+    unmapIndices(meshData);
+
+    VertexCacheStats before = analyzeVertexCache(meshData.indices.data(), meshData.indices.size(), meshData.vertexCount());
+    auto begin = std::chrono::steady_clock::now();
+    optimizeVertexCache(meshData);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    VertexCacheStats after = analyzeVertexCache(meshData.indices.data(), meshData.indices.size(), meshData.vertexCount());
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(3) << "Vertex cache (FIFO 16): ACMR " << before.acmr << " -> " << after.acmr
+         << ", ATVR " << before.atvr << " -> " << after.atvr << std::setprecision(1) << " in " << ms << " ms.";
+    std::cout << line.str() << std::endl;
+    if (!overdraw) return false;
+
+    // The overdraw estimate rasterizes six views of the mesh; it only costs
+    // load time when this pass is requested.
+    double overdrawBefore = analyzeOverdraw(meshData);
+    std::vector<unsigned int> cacheOrder(meshData.indices);
+    begin = std::chrono::steady_clock::now();
+    size_t clusters = optimizeOverdraw(meshData, options.overdrawThreshold);
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    double overdrawAfter = analyzeOverdraw(meshData);
+
+    line.str("");
+    line << std::setprecision(3) << "Overdraw: " << overdrawBefore << " -> " << overdrawAfter << " over " << clusters;
+    bool gain = overdrawAfter < overdrawBefore;
+    if (!gain) {
+        // The cluster sort scatters the triangles over the mesh, which the
+        // meshlets (they follow it) and the 16-bit chunks pay for; not worth
+        // it for nothing.
+        meshData.indices.swap(cacheOrder);
+        line << " clusters, no gain; kept the vertex cache order";
+    }
+    else {
+        VertexCacheStats clustered = analyzeVertexCache(meshData.indices.data(), meshData.indices.size(), meshData.vertexCount());
+        line << " clusters, ACMR " << after.acmr << " -> " << clustered.acmr;
+    }
+    line << std::setprecision(1) << " in " << ms << " ms.";
+    std::cout << line.str() << std::endl;
+    return gain;
+}
+
+// Index and vertex buffer optimizations, the picking BVH and the outline
+// edges selected in options; they run once a loader has produced the final
+// triangles.
+static void optimizeMesh(MeshData& meshData, const MeshLoadOptions& options) {
+    if (meshData.indexCount() < 3) return;
+    if (options.previewCells > 0 && options.progress) {
+        // Everything below can take many seconds on huge meshes; hand the
+        // viewer something to draw first.
+        auto begin = std::chrono::steady_clock::now();
+        std::unique_ptr<MeshData> preview(new MeshData);
+        buildPreviewMesh(meshData, options.previewCells, *preview);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1) << "Preview: " << preview->indices.size() / 3 << " triangles on a "
+             << options.previewCells << "-cell grid in " << ms << " ms.";
+        std::cout << line.str() << std::endl;
+        options.progress->preview = std::move(preview);
+        options.progress->previewReady.store(true, std::memory_order_release);
+    }
+    bool overdrawOrder = optimizeTriangleOrder(meshData, options);
+    if (options.buildMeshlets) {
+        unmapIndices(meshData);
+        VertexCacheStats before = analyzeVertexCache(meshData.indices.data(), meshData.indices.size(), meshData.vertexCount());
+        auto begin = std::chrono::steady_clock::now();
+        size_t count = buildMeshlets(meshData, overdrawOrder);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        VertexCacheStats after = analyzeVertexCache(meshData.indices.data(), meshData.indices.size(), meshData.vertexCount());
+        size_t withCone = 0;
+        for (const Meshlet& meshlet : meshData.meshlets) withCone += meshlet.coneCutoff < 1.0f;
+
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1) << "Meshlets: " << count << " of "
+             << double(meshData.indices.size() / 3) / double(count) << " triangles on average, " << withCone
+             << " with a normal cone, ACMR " << std::setprecision(3) << before.acmr << " -> " << after.acmr
+             << std::setprecision(1) << " in " << ms << " ms.";
+        // They keep the overdraw pass's order only at meshlet granularity.
+        if (overdrawOrder) {
+            line << std::setprecision(3) << " Overdraw now " << analyzeOverdraw(meshData) << ".";
+        }
+        std::cout << line.str() << std::endl;
+    }
+    if (options.lodLevels > 0) {
+        unmapIndices(meshData);
+        auto begin = std::chrono::steady_clock::now();
+        generateLods(meshData, options.lodLevels);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::ostringstream line;
+        if (meshData.lods.empty()) {
+            line << "LOD chain: none, the " << meshData.baseIndexCount() / 3 << " triangles don't simplify";
+        }
+        else {
+            line << "LOD chain: " << meshData.baseIndexCount() / 3;
+            for (const MeshLod& lod : meshData.lods) line << " -> " << lod.indexCount / 3;
+            line << std::fixed << std::setprecision(2) << " triangles (error up to "
+                 << 100.0f * meshData.lods.back().error << "% of radius)";
+        }
+        line << std::fixed << std::setprecision(1) << " in " << ms << " ms.";
+        std::cout << line.str() << std::endl;
+    }
+    if (options.optimizeVertexFetch) {
+        // Last of the buffer passes, so it follows the final triangle order.
+        unmapIndices(meshData);
+        unmapVertices(meshData);
+        auto begin = std::chrono::steady_clock::now();
+        size_t dropped = optimizeVertexFetch(meshData);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << "Vertex fetch: renumbered " << meshData.vertices.size() << " vertices in first-use order";
+        if (dropped > 0) std::cout << ", dropped " << dropped << " unused";
+        std::cout << " in " << ms << " ms." << std::endl;
+    }
+    if (options.buildBvh) {
+        auto begin = std::chrono::steady_clock::now();
+        size_t nodes = buildBvh(meshData);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1) << "BVH: " << nodes << " nodes over "
+             << meshData.bvhTriangles.size() << " triangles in " << ms << " ms.";
+        std::cout << line.str() << std::endl;
+    }
+    if (options.buildOutlineEdges) {
+        // Stores vertex numbers, so it has to follow the vertex fetch pass.
+        auto begin = std::chrono::steady_clock::now();
+        size_t edges = buildOutlineEdges(meshData, options.outlineCreaseAngle);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        size_t creases = 0;
+        for (const EdgeCluster& cluster : meshData.edgeClusters) creases += cluster.creaseCount;
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1) << "Outline edges: " << edges << " (" << creases << " creases) in "
+             << meshData.edgeClusters.size() << " clusters in " << ms << " ms.";
+        std::cout << line.str() << std::endl;
+    }
+}
+
+// Digest of the options that change the loaded mesh (not how it is parsed),
+// stored in the mesh cache so a cache built with other settings is ignored.
+static uint32_t meshSettingsKey(const MeshLoadOptions& options) {
+    uint32_t crease;
+    std::memcpy(&crease, &options.normals.creaseAngle, sizeof(crease));
+    uint32_t key = 2166136261u;
+    auto mix = [&key](uint32_t value) { key = (key ^ value) * 16777619u; };
+    mix(static_cast<uint32_t>(options.normals.weighting));
+    mix(crease);
+    mix(options.normals.useSmoothingGroups && !options.streaming ? 1u : 0u);
+    uint32_t weld = 0;
+    if (!options.streaming) std::memcpy(&weld, &options.weldTolerance, sizeof(weld));
+    mix(weld);
+    mix(options.optimizeVertexCache ? 1u : 0u);
+    uint32_t overdraw;
+    std::memcpy(&overdraw, &options.overdrawThreshold, sizeof(overdraw));
+    mix(overdraw);
+    mix(options.optimizeVertexFetch ? 1u : 0u);
+    mix(options.buildMeshlets ? 1u : 0u);
+    mix(options.buildBvh ? 1u : 0u);
+    uint32_t outlineCrease = 0;
+    if (options.buildOutlineEdges) std::memcpy(&outlineCrease, &options.outlineCreaseAngle, sizeof(outlineCrease));
+    mix(options.buildOutlineEdges ? 1u : 0u);
+    mix(outlineCrease);
+    mix(options.lodLevels);
+    return key;
+}
+
+const char* meshLoadStageName(int stage) {
+    switch (stage) {
+    case MeshLoadProgress::QUEUED:        return "queued";
+    case MeshLoadProgress::READING_CACHE: return "reading cache";
+    case MeshLoadProgress::PARSING:       return "parsing";
+    case MeshLoadProgress::WRITING_CACHE: return "writing cache";
+    case MeshLoadProgress::DONE:          return "done";
+    }
+    return "";
+}
+
+static void setLoadStage(const MeshLoadOptions& options, MeshLoadProgress::Stage stage) {
+    if (options.progress) options.progress->stage.store(stage);
+}
+
+// Every format goes through the mesh cache the same way: a hit skips both
+// parse (the format's loader) and optimizeMesh; a miss runs them and stores
+// the optimized result under the same settings key.
+static bool loadThroughCache(const std::string& filepath, MeshData& meshData, const MeshLoadOptions& options,
+                             const std::function<bool()>& parse) {
+    setLoadStage(options, MeshLoadProgress::READING_CACHE);
+    if (options.useCache && loadMeshCache(filepath, meshData, meshSettingsKey(options))) {
+        setLoadStage(options, MeshLoadProgress::DONE);
+        return true;
+    }
+
+    setLoadStage(options, MeshLoadProgress::PARSING);
+    if (!parse()) {
+        return false;
+    }
+    optimizeMesh(meshData, options);
+    meshData.computeBounds();
+
+    setLoadStage(options, MeshLoadProgress::WRITING_CACHE);
+    if (options.useCache && meshData.vertexCount() > 0 && !writeMeshCache(filepath, meshData, meshSettingsKey(options))) {
+        std::cerr << "Warning: could not write mesh cache for '" << filepath << "'." << std::endl;
+    }
+    setLoadStage(options, MeshLoadProgress::DONE);
+    return true;
+}
+
+bool loadObjModel(const std::string& filepath, MeshData& meshData, const MeshLoadOptions& options) {
+    return loadThroughCache(filepath, meshData, options, [&]() {
+        return options.streaming ? streamObjModel(filepath, meshData, options.normals)
+                                 : parseObjModel(filepath, meshData, options);
+    });
+}
+
+static bool hasExtension(const std::string& filepath, const std::string& extension) {
+    if (filepath.size() < extension.size()) return false;
+    for (size_t i = 0; i < extension.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(filepath[filepath.size() - extension.size() + i])) != extension[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Packs 16-bit indices and reports what it cost. Past 65536 vertices the
+// chunks need copied vertices; a mesh that still ends up on 32-bit indices
+// there is worth knowing about, since every optimized mesh should pack.
+static void packIndices(MeshData& meshData) {
+    auto begin = std::chrono::steady_clock::now();
+    bool packed = packShortIndices(meshData);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    size_t vertexCount = meshData.vertexCount();
+    if (vertexCount <= 65536) return;
+    if (!packed) {
+        std::cerr << "Warning: " << vertexCount << " vertices kept on 32-bit indices; the 16-bit chunks would "
+                  << "need more copied vertices than they save." << std::endl;
+        return;
+    }
+    size_t copies = meshData.chunkVertices.size() - std::min(meshData.chunkVertices.size(), vertexCount);
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1) << "16-bit indices: " << meshData.indexChunks.size() << " chunks, "
+         << copies << " copied vertices (" << 100.0 * copies / vertexCount << "%) in " << ms << " ms.";
+    std::cout << line.str() << std::endl;
+}
+
+bool loadModel(const std::string& filepath, MeshData& meshData, const MeshLoadOptions& options) {
+    bool loaded;
+    if (hasExtension(filepath, ".glb")) {
+        loaded = loadThroughCache(filepath, meshData, options, [&]() { return loadGlbModel(filepath, meshData, options); });
+    }
+    else if (hasExtension(filepath, ".ply")) {
+        loaded = loadThroughCache(filepath, meshData, options, [&]() { return loadPlyModel(filepath, meshData, options); });
+    }
+    else {
+        loaded = loadObjModel(filepath, meshData, options);
+    }
+    if (loaded && options.shortIndices) packIndices(meshData);
+    return loaded;
+}
@@ -0,0 +1,253 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "vertex_format.h"
+
+// Layout of every mesh the app loads; see vertex_format.h. The mesh cache
+// and the .glb/.ply fast paths assume these 24 bytes.
+typedef PackedVertex<PositionAttribute, NormalAttribute> Vertex;
+
+// Contiguous index range of one OBJ shape drawn with one material. The
+// loaders sort submeshes by material so that all ranges of a material are
+// adjacent and can go out in a single multi-draw.
+struct Submesh {
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = 0;
+    int materialId = -1;        // into MeshData::materials; -1 = none
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+// Stretch of the index buffer drawn from 16-bit indices with a base-vertex
+// draw: its vertices are the (at most 65536) entries of the 16-bit vertex
+// layout from baseVertex on (see MeshData::chunkVertices).
+struct IndexChunk {
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = 0;
+    unsigned int baseVertex = 0;
+};
+
+// One coarser level of the mesh (see lod.h). Its triangles follow the
+// full-resolution ones in MeshData::indices and use the same vertices, and
+// each of its parts repeats the material and bounds of the matching
+// MeshData::submeshes entry.
+struct MeshLod {
+    float error = 0.0f;             // geometric error / bounding-sphere radius
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = 0;
+    unsigned int submeshOffset = 0; // into MeshData::lodSubmeshes
+    unsigned int submeshCount = 0;
+};
+
+// Cluster of up to 64 vertices and 124 full-resolution triangles (see
+// meshlet.h), contiguous in MeshData::indices and inside one submesh.
+// Bounding sphere and normal cone are in mesh space; coneCutoff >= 1 means
+// the triangles face too many ways for the cone to cull them.
+struct Meshlet {
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = 0;
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    glm::vec3 coneAxis = glm::vec3(0.0f);
+    float coneCutoff = 1.0f;        // sine of the cone's half-angle
+};
+
+// Node of the triangle BVH (see bvh.h). A leaf (triangleCount > 0) covers
+// MeshData::bvhTriangles[first, first + triangleCount); an inner node's
+// children are nodes first and first + 1.
+struct BvhNode {
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    unsigned int first = 0;
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    unsigned int triangleCount = 0;
+};
+
+// Edge of the full-resolution surface, for outlines (see outline.h): the
+// vertices to draw it between and the octahedral-encoded normals (snorm16)
+// of the two faces that meet there. An open edge stores its one face's
+// normal negated as the second, so it always counts as a silhouette.
+struct MeshEdge {
+    unsigned int vertices[2] = { 0, 0 };
+    int16_t normals[2][2] = { { 0, 0 }, { 0, 0 } };
+};
+
+// Run of MeshData::edges whose first creaseCount entries are creases.
+// Bounding sphere and normal cone (as in Meshlet) cover both faces of every
+// edge in it.
+struct EdgeCluster {
+    unsigned int edgeOffset = 0;
+    unsigned int edgeCount = 0;
+    unsigned int creaseCount = 0;
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    glm::vec3 coneAxis = glm::vec3(0.0f);
+    float coneCutoff = 1.0f;
+};
+
+struct MeshMaterial {
+    glm::vec3 diffuse = glm::vec3(0.6f);
+};
+
+struct MeshData {
+    std::vector<Vertex>       vertices;
+    std::vector<unsigned int> indices;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    // Empty for meshes without parts (PLY scans, placeholders); they are
+    // drawn as one range.
+    std::vector<Submesh> submeshes;
+    std::vector<MeshMaterial> materials;
+
+    // Filled by packShortIndices() (index_chunks.h) when the mesh can be
+    // drawn from 16-bit indices; uploadMesh then prefers them. indices keeps
+    // the 32-bit form for CPU-side use.
+    std::vector<uint16_t> shortIndices;
+    std::vector<IndexChunk> indexChunks;
+    // The vertex (into vertexData()) behind each entry of the GPU vertex
+    // buffer that goes with shortIndices. Every chunk has its own run of
+    // entries, so a vertex shared by several chunks is listed once per
+    // chunk. Empty when that buffer is the vertex array itself.
+    std::vector<unsigned int> chunkVertices;
+
+    // Coarsest last. Empty unless MeshLoadOptions::lodLevels was set.
+    std::vector<MeshLod> lods;
+    std::vector<Submesh> lodSubmeshes;
+
+    // In index order. Empty unless MeshLoadOptions::buildMeshlets was set.
+    std::vector<Meshlet> meshlets;
+
+    // Full-resolution triangles (index / 3) in BVH leaf order. Empty unless
+    // MeshLoadOptions::buildBvh was set.
+    std::vector<BvhNode> bvh;
+    std::vector<unsigned int> bvhTriangles;
+
+    // Grouped by cluster. Empty unless MeshLoadOptions::buildOutlineEdges
+    // was set.
+    std::vector<MeshEdge> edges;
+    std::vector<EdgeCluster> edgeClusters;
+
+    // Set when an array lives in a mapped file (the binary mesh cache, or a
+    // .glb whose layout matches) instead of vertices/indices, so the GPU
+    // upload reads straight from the page cache. Either array can be mapped
+    // on its own; the other one is then used from the vector. Every pass and
+    // the renderer read one interleaved Vertex array, so only that exact
+    // layout maps: a .glb with POSITION and NORMAL in separate buffer views
+    // (what most exporters write) or any other stride is copied per vertex.
+    std::shared_ptr<MappedFile> mapping;
+    const Vertex*       mappedVertices = nullptr;
+    const unsigned int* mappedIndices = nullptr;
+    size_t mappedVertexCount = 0;
+    size_t mappedIndexCount = 0;
+    bool fromCache = false;
+
+    const Vertex* vertexData() const { return mappedVertices ? mappedVertices : vertices.data(); }
+    const unsigned int* indexData() const { return mappedIndices ? mappedIndices : indices.data(); }
+    size_t vertexCount() const { return mappedVertices ? mappedVertexCount : vertices.size(); }
+    size_t indexCount() const { return mappedIndices ? mappedIndexCount : indices.size(); }
+    // Indices of the full-resolution mesh; any LOD levels follow them.
+    size_t baseIndexCount() const { return lods.empty() ? indexCount() : lods.front().indexOffset; }
+
+    void computeBounds();
+    // Empties every array, mapped or not.
+    void clear();
+};
+
+struct NormalGenOptions {
+    enum Weighting { ANGLE, AREA };
+    Weighting weighting = ANGLE;
+    // Faces whose normals differ by more than this many degrees don't share
+    // vertex normals; 180 keeps every vertex smooth.
+    float creaseAngle = 180.0f;
+    // Honour OBJ "s" records: only faces of the same group are smoothed
+    // together and "s off" faces are flat. Not available when streaming.
+    bool useSmoothingGroups = false;
+    unsigned int threads = 0;
+};
+
+// Lets another thread watch a load in progress (see AsyncMeshLoad).
+struct MeshLoadProgress {
+    enum Stage { QUEUED, READING_CACHE, PARSING, WRITING_CACHE, DONE };
+    std::atomic<int> stage{ QUEUED };
+    // Coarse stand-in for the mesh, published once its triangles are known
+    // and before the optimizations run (MeshLoadOptions::previewCells).
+    // Written once, then previewReady is set; read it only after that.
+    std::unique_ptr<MeshData> preview;
+    std::atomic<bool> previewReady{ false };
+};
+
+const char* meshLoadStageName(int stage);
+
+struct MeshLoadOptions {
+    bool useCache = true;
+    // 0 = one OBJ parser thread per hardware thread; 1 = tinyobj's own
+    // single-threaded LoadObj.
+    unsigned int parseThreads = 0;
+    // Parse straight from a memory mapping of the OBJ instead of an ifstream
+    // copy. Ignored by the tinyobj path.
+    bool mapInput = true;
+    // Build the mesh from tinyobj's callback parser as faces arrive, without
+    // an intermediate attrib_t/shape list. Single-threaded; lowest peak memory.
+    bool streaming = false;
+    // Weld positions closer than this fraction of the bounding box diagonal
+    // before vertices are deduplicated, e.g. 1e-5 for seam-split scans.
+    // 0 disables welding. Not available when streaming.
+    float weldTolerance = 0.0f;
+    // Reorder each submesh's triangles for the GPU's post-transform vertex
+    // cache (vertex_cache.h) and print ACMR/ATVR before and after. OBJ meshes
+    // are cached in the optimized order.
+    bool optimizeVertexCache = false;
+    // Then sort clusters of those triangles so outward-facing ones are drawn
+    // first (overdraw.h), letting ACMR grow by up to this factor; e.g. 1.05.
+    // Implies optimizeVertexCache. 0 disables.
+    float overdrawThreshold = 0.0f;
+    // Renumber vertices in the order the final index buffer uses them
+    // (vertex_fetch.h), so the VBO is read nearly sequentially.
+    bool optimizeVertexFetch = false;
+    // Regroup each submesh's triangles into meshlets (meshlet.h) that the
+    // renderer can cull against the view frustum and by facing.
+    bool buildMeshlets = false;
+    // Build a triangle BVH over the full-resolution mesh (bvh.h) for picking.
+    bool buildBvh = false;
+    // Build the edge table that silhouette and crease outlines are extracted
+    // from each frame (outline.h). Faces meeting at more than
+    // outlineCreaseAngle degrees make a crease, outlined whenever it shows.
+    bool buildOutlineEdges = false;
+    float outlineCreaseAngle = 60.0f;
+    // Coarser levels of detail to build by quadric edge collapse (lod.h),
+    // each about half the triangles of the one before; 0 = none.
+    unsigned int lodLevels = 0;
+    // When set and progress is given, a vertex-clustered preview on a grid
+    // of this many cells along the longest side (mesh_preview.h) is
+    // published through progress as soon as the triangles are known, so a
+    // viewer can show the model while the passes above run. 0 = none.
+    unsigned int previewCells = 0;
+    // Pack the indices for a 16-bit index buffer when they fit (see
+    // index_chunks.h).
+    bool shortIndices = true;
+    // Used for vertices the OBJ gives no normal for.
+    NormalGenOptions normals;
+    MeshLoadProgress* progress = nullptr;
+};
+
+// filepath may also name a gzip-compressed OBJ (e.g. model.obj.gz); it is
+// inflated while parsing, without a temporary file.
+bool loadObjModel(const std::string& filepath, MeshData& meshData,
+                  const MeshLoadOptions& options = MeshLoadOptions());
+
+// Picks the loader from the extension: .glb goes to loadGlbModel
+// (gltf_loader.h), .ply to loadPlyModel (ply_loader.h), everything else to
+// loadObjModel. Every format is optimized and cached (mesh_cache.h) as in
+// loadObjModel. Then packs 16-bit indices if options.shortIndices is set.
+bool loadModel(const std::string& filepath, MeshData& meshData,
+               const MeshLoadOptions& options = MeshLoadOptions());
+
+#endif
@@ -0,0 +1,290 @@
+#include "mesh_cache.h"
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const char CACHE_MAGIC[8] = { 'T', 'O', 'O', 'N', 'M', 'E', 'S', 'H' };
+const uint32_t CACHE_VERSION = 8;
+const uint64_t SECTION_ALIGNMENT = 16;
+
+struct MeshCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t vertexStride;  // sizeof(Vertex) when written; guards layout changes
+    uint64_t sourceSize;
+    int64_t  sourceMtime;
+    uint64_t sourceHash;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    float    boundsMin[3];
+    float    boundsMax[3];
+    uint32_t pathLength;    // source path bytes follow the header
+    uint32_t settingsKey;   // loader settings that change the output mesh
+    uint64_t submeshCount;
+    uint64_t materialCount;
+    uint64_t submeshOffset;
+    uint64_t materialOffset;
+    uint64_t lodCount;
+    uint64_t lodSubmeshCount;
+    uint64_t lodOffset;
+    uint64_t lodSubmeshOffset;
+    uint64_t meshletCount;
+    uint64_t meshletOffset;
+    uint64_t bvhNodeCount;
+    uint64_t bvhTriangleCount;
+    uint64_t bvhNodeOffset;
+    uint64_t bvhTriangleOffset;
+    uint64_t edgeCount;
+    uint64_t edgeClusterCount;
+    uint64_t edgeOffset;
+    uint64_t edgeClusterOffset;
+};
+
+struct SourceFingerprint {
+    uint64_t size;
+    int64_t  mtime;
+    uint64_t hash;
+};
+
+uint64_t alignUp(uint64_t value) {
+    return (value + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+// 64-bit multiply/rotate hash over 8-byte words. Only needs to detect edits,
+// and has to stay far cheaper than re-parsing the OBJ.
+uint64_t hashBytes(const unsigned char* data, size_t size) {
+    const uint64_t prime = 0x9E3779B97F4A7C15ull;
+    uint64_t h = 0xCBF29CE484222325ull ^ (uint64_t(size) * prime);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h ^= word * prime;
+        h = (h << 31) | (h >> 33);
+        h *= 0xC2B2AE3D27D4EB4Full;
+    }
+    for (; i < size; ++i) {
+        h ^= data[i];
+        h *= 0x100000001B3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Checks one section of the file: aligned, starting at or after end (the
+// end of the section before it), and holding count elements of size bytes
+// before the end of the file; then moves end past it. The count is
+// compared against the room left rather than multiplied out, so a corrupt
+// header can't wrap the arithmetic around and pass.
+bool sectionFits(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize, uint64_t& end) {
+    if (offset < end || offset > fileSize || offset % SECTION_ALIGNMENT != 0) return false;
+    if (count > (fileSize - offset) / size) return false;
+    end = offset + count * size;
+    return true;
+}
+
+bool statSource(const std::string& sourcePath, SourceFingerprint& fp) {
+    struct stat st;
+    if (stat(sourcePath.c_str(), &st) != 0) return false;
+    fp.size = static_cast<uint64_t>(st.st_size);
+    fp.mtime = static_cast<int64_t>(st.st_mtime);
+    fp.hash = 0;
+    return true;
+}
+
+bool hashSource(const std::string& sourcePath, SourceFingerprint& fp) {
+    MappedFile source;
+    if (!source.open(sourcePath, true)) return false;
+    fp.hash = hashBytes(source.data(), source.size());
+    return true;
+}
+
+}  // namespace
+
+
+std::string meshCachePath(const std::string& sourcePath) {
+    return sourcePath + ".meshcache";
+}
+
+bool loadMeshCache(const std::string& sourcePath, MeshData& meshData, uint32_t settingsKey) {
+    SourceFingerprint fp;
+    if (!statSource(sourcePath, fp)) return false;
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(meshCachePath(sourcePath))) return false;
+
+    if (file->size() < sizeof(MeshCacheHeader)) return false;
+    MeshCacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.version != CACHE_VERSION || header.vertexStride != sizeof(Vertex) ||
+        header.settingsKey != settingsKey) {
+        return false;
+    }
+    if (header.sourceSize != fp.size || header.sourceMtime != fp.mtime) return false;
+
+    uint64_t pathEnd = sizeof(MeshCacheHeader) + uint64_t(header.pathLength);
+    if (pathEnd > file->size() ||
+        sourcePath.compare(0, std::string::npos, reinterpret_cast<const char*>(file->data()) + sizeof(MeshCacheHeader),
+                           header.pathLength) != 0) {
+        return false;
+    }
+
+    uint64_t fileSize = file->size();
+    uint64_t end = pathEnd;
+    if (!sectionFits(header.vertexOffset, header.vertexCount, sizeof(Vertex), fileSize, end) ||
+        !sectionFits(header.indexOffset, header.indexCount, sizeof(unsigned int), fileSize, end) ||
+        !sectionFits(header.submeshOffset, header.submeshCount, sizeof(Submesh), fileSize, end) ||
+        !sectionFits(header.materialOffset, header.materialCount, sizeof(MeshMaterial), fileSize, end) ||
+        !sectionFits(header.lodOffset, header.lodCount, sizeof(MeshLod), fileSize, end) ||
+        !sectionFits(header.lodSubmeshOffset, header.lodSubmeshCount, sizeof(Submesh), fileSize, end) ||
+        !sectionFits(header.meshletOffset, header.meshletCount, sizeof(Meshlet), fileSize, end) ||
+        !sectionFits(header.bvhNodeOffset, header.bvhNodeCount, sizeof(BvhNode), fileSize, end) ||
+        !sectionFits(header.bvhTriangleOffset, header.bvhTriangleCount, sizeof(unsigned int), fileSize, end) ||
+        !sectionFits(header.edgeOffset, header.edgeCount, sizeof(MeshEdge), fileSize, end) ||
+        !sectionFits(header.edgeClusterOffset, header.edgeClusterCount, sizeof(EdgeCluster), fileSize, end)) {
+        std::cerr << "Warning: mesh cache for '" << sourcePath << "' is truncated or corrupt; re-parsing." << std::endl;
+        return false;
+    }
+
+    // Size and mtime matched; the content hash catches edits that kept both.
+    if (!hashSource(sourcePath, fp) || fp.hash != header.sourceHash) return false;
+
+    meshData.clear();
+    meshData.mappedVertices = reinterpret_cast<const Vertex*>(file->data() + header.vertexOffset);
+    meshData.mappedIndices = reinterpret_cast<const unsigned int*>(file->data() + header.indexOffset);
+    meshData.mappedVertexCount = static_cast<size_t>(header.vertexCount);
+    meshData.mappedIndexCount = static_cast<size_t>(header.indexCount);
+    meshData.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    meshData.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    // The tables are tiny next to the arrays above, so they are copied out.
+    const Submesh* submeshes = reinterpret_cast<const Submesh*>(file->data() + header.submeshOffset);
+    meshData.submeshes.assign(submeshes, submeshes + header.submeshCount);
+    const MeshMaterial* materials = reinterpret_cast<const MeshMaterial*>(file->data() + header.materialOffset);
+    meshData.materials.assign(materials, materials + header.materialCount);
+    const MeshLod* lods = reinterpret_cast<const MeshLod*>(file->data() + header.lodOffset);
+    meshData.lods.assign(lods, lods + header.lodCount);
+    const Submesh* lodSubmeshes = reinterpret_cast<const Submesh*>(file->data() + header.lodSubmeshOffset);
+    meshData.lodSubmeshes.assign(lodSubmeshes, lodSubmeshes + header.lodSubmeshCount);
+    const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(file->data() + header.meshletOffset);
+    meshData.meshlets.assign(meshlets, meshlets + header.meshletCount);
+    const BvhNode* bvhNodes = reinterpret_cast<const BvhNode*>(file->data() + header.bvhNodeOffset);
+    meshData.bvh.assign(bvhNodes, bvhNodes + header.bvhNodeCount);
+    const unsigned int* bvhTriangles = reinterpret_cast<const unsigned int*>(file->data() + header.bvhTriangleOffset);
+    meshData.bvhTriangles.assign(bvhTriangles, bvhTriangles + header.bvhTriangleCount);
+    const MeshEdge* edges = reinterpret_cast<const MeshEdge*>(file->data() + header.edgeOffset);
+    meshData.edges.assign(edges, edges + header.edgeCount);
+    const EdgeCluster* edgeClusters = reinterpret_cast<const EdgeCluster*>(file->data() + header.edgeClusterOffset);
+    meshData.edgeClusters.assign(edgeClusters, edgeClusters + header.edgeClusterCount);
+    meshData.mapping = file;
+    meshData.fromCache = true;
+    return true;
+}
+
+bool writeMeshCache(const std::string& sourcePath, const MeshData& meshData, uint32_t settingsKey) {
+    SourceFingerprint fp;
+    if (!statSource(sourcePath, fp) || !hashSource(sourcePath, fp)) return false;
+
+    MeshCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.vertexStride = sizeof(Vertex);
+    header.sourceSize = fp.size;
+    header.sourceMtime = fp.mtime;
+    header.sourceHash = fp.hash;
+    header.vertexCount = meshData.vertexCount();
+    header.indexCount = meshData.indexCount();
+    header.pathLength = static_cast<uint32_t>(sourcePath.size());
+    header.settingsKey = settingsKey;
+    header.vertexOffset = alignUp(sizeof(MeshCacheHeader) + sourcePath.size());
+    header.indexOffset = alignUp(header.vertexOffset + header.vertexCount * sizeof(Vertex));
+    header.submeshCount = meshData.submeshes.size();
+    header.materialCount = meshData.materials.size();
+    header.submeshOffset = alignUp(header.indexOffset + header.indexCount * sizeof(unsigned int));
+    header.materialOffset = alignUp(header.submeshOffset + header.submeshCount * sizeof(Submesh));
+    header.lodCount = meshData.lods.size();
+    header.lodSubmeshCount = meshData.lodSubmeshes.size();
+    header.lodOffset = alignUp(header.materialOffset + header.materialCount * sizeof(MeshMaterial));
+    header.lodSubmeshOffset = alignUp(header.lodOffset + header.lodCount * sizeof(MeshLod));
+    header.meshletCount = meshData.meshlets.size();
+    header.meshletOffset = alignUp(header.lodSubmeshOffset + header.lodSubmeshCount * sizeof(Submesh));
+    header.bvhNodeCount = meshData.bvh.size();
+    header.bvhTriangleCount = meshData.bvhTriangles.size();
+    header.bvhNodeOffset = alignUp(header.meshletOffset + header.meshletCount * sizeof(Meshlet));
+    header.bvhTriangleOffset = alignUp(header.bvhNodeOffset + header.bvhNodeCount * sizeof(BvhNode));
+    header.edgeCount = meshData.edges.size();
+    header.edgeClusterCount = meshData.edgeClusters.size();
+    header.edgeOffset = alignUp(header.bvhTriangleOffset + header.bvhTriangleCount * sizeof(unsigned int));
+    header.edgeClusterOffset = alignUp(header.edgeOffset + header.edgeCount * sizeof(MeshEdge));
+    for (int i = 0; i < 3; ++i) {
+        header.boundsMin[i] = meshData.boundsMin[i];
+        header.boundsMax[i] = meshData.boundsMax[i];
+    }
+
+    // Write to a temporary name first so a crash never leaves a half-written
+    // cache that passes the header checks.
+    std::string cachePath = meshCachePath(sourcePath);
+    std::string tempPath = cachePath + ".tmp";
+    FILE* out = std::fopen(tempPath.c_str(), "wb");
+    if (!out) return false;
+
+    static const char padding[SECTION_ALIGNMENT] = {};
+    uint64_t written = 0;
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+    written += sizeof(header);
+    ok = ok && std::fwrite(sourcePath.data(), 1, sourcePath.size(), out) == sourcePath.size();
+    written += sourcePath.size();
+    ok = ok && std::fwrite(padding, 1, size_t(header.vertexOffset - written), out) == header.vertexOffset - written;
+    written = header.vertexOffset;
+    ok = ok && std::fwrite(meshData.vertexData(), sizeof(Vertex), size_t(header.vertexCount), out) == header.vertexCount;
+    written += header.vertexCount * sizeof(Vertex);
+    ok = ok && std::fwrite(padding, 1, size_t(header.indexOffset - written), out) == header.indexOffset - written;
+    ok = ok && std::fwrite(meshData.indexData(), sizeof(unsigned int), size_t(header.indexCount), out) == header.indexCount;
+    written = header.indexOffset + header.indexCount * sizeof(unsigned int);
+    ok = ok && std::fwrite(padding, 1, size_t(header.submeshOffset - written), out) == header.submeshOffset - written;
+    ok = ok && std::fwrite(meshData.submeshes.data(), sizeof(Submesh), meshData.submeshes.size(), out) == meshData.submeshes.size();
+    written = header.submeshOffset + header.submeshCount * sizeof(Submesh);
+    ok = ok && std::fwrite(padding, 1, size_t(header.materialOffset - written), out) == header.materialOffset - written;
+    ok = ok && std::fwrite(meshData.materials.data(), sizeof(MeshMaterial), meshData.materials.size(), out) == meshData.materials.size();
+    written = header.materialOffset + header.materialCount * sizeof(MeshMaterial);
+    ok = ok && std::fwrite(padding, 1, size_t(header.lodOffset - written), out) == header.lodOffset - written;
+    ok = ok && std::fwrite(meshData.lods.data(), sizeof(MeshLod), meshData.lods.size(), out) == meshData.lods.size();
+    written = header.lodOffset + header.lodCount * sizeof(MeshLod);
+    ok = ok && std::fwrite(padding, 1, size_t(header.lodSubmeshOffset - written), out) == header.lodSubmeshOffset - written;
+    ok = ok && std::fwrite(meshData.lodSubmeshes.data(), sizeof(Submesh), meshData.lodSubmeshes.size(), out) == meshData.lodSubmeshes.size();
+    written = header.lodSubmeshOffset + header.lodSubmeshCount * sizeof(Submesh);
+    ok = ok && std::fwrite(padding, 1, size_t(header.meshletOffset - written), out) == header.meshletOffset - written;
+    ok = ok && std::fwrite(meshData.meshlets.data(), sizeof(Meshlet), meshData.meshlets.size(), out) == meshData.meshlets.size();
+    written = header.meshletOffset + header.meshletCount * sizeof(Meshlet);
+    ok = ok && std::fwrite(padding, 1, size_t(header.bvhNodeOffset - written), out) == header.bvhNodeOffset - written;
+    ok = ok && std::fwrite(meshData.bvh.data(), sizeof(BvhNode), meshData.bvh.size(), out) == meshData.bvh.size();
+    written = header.bvhNodeOffset + header.bvhNodeCount * sizeof(BvhNode);
+    ok = ok && std::fwrite(padding, 1, size_t(header.bvhTriangleOffset - written), out) == header.bvhTriangleOffset - written;
+    ok = ok && std::fwrite(meshData.bvhTriangles.data(), sizeof(unsigned int), meshData.bvhTriangles.size(), out) == meshData.bvhTriangles.size();
+    written = header.bvhTriangleOffset + header.bvhTriangleCount * sizeof(unsigned int);
+    ok = ok && std::fwrite(padding, 1, size_t(header.edgeOffset - written), out) == header.edgeOffset - written;
+    ok = ok && std::fwrite(meshData.edges.data(), sizeof(MeshEdge), meshData.edges.size(), out) == meshData.edges.size();
+    written = header.edgeOffset + header.edgeCount * sizeof(MeshEdge);
+    ok = ok && std::fwrite(padding, 1, size_t(header.edgeClusterOffset - written), out) == header.edgeClusterOffset - written;
+    ok = ok && std::fwrite(meshData.edgeClusters.data(), sizeof(EdgeCluster), meshData.edgeClusters.size(), out) == meshData.edgeClusters.size();
+    ok = (std::fclose(out) == 0) && ok;
+
+    if (!ok) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    std::remove(cachePath.c_str());
+    return std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+}
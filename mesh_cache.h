@@ -0,0 +1,23 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include "mesh.h"
+
+// Binary cache of the final deduplicated MeshData, stored next to the source
+// file as "<source>.meshcache". An entry is only used when the source path,
+// size, modification time and content hash all still match, and it was
+// written with the same settingsKey (a digest of the loader options that
+// affect the resulting mesh).
+
+std::string meshCachePath(const std::string& sourcePath);
+
+// On a hit the cache file is memory-mapped and meshData points into it
+// (see MeshData::mapping); nothing is copied.
+bool loadMeshCache(const std::string& sourcePath, MeshData& meshData, uint32_t settingsKey);
+
+bool writeMeshCache(const std::string& sourcePath, const MeshData& meshData, uint32_t settingsKey);
+
+#endif
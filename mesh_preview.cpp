@@ -0,0 +1,155 @@
+#include "mesh_preview.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// 128^3 cells keep the cell table at 8 MB and every cell number within the
+// 21 bits a packed triangle key has for it.
+const unsigned int MAX_GRID_CELLS = 128;
+const unsigned int NO_SLOT = ~0u;
+
+struct Cluster {
+    glm::vec3 positionSum = glm::vec3(0.0f);
+    glm::vec3 normalSum = glm::vec3(0.0f);
+    unsigned int count = 0;
+    unsigned int vertex = NO_SLOT;  // preview vertex, once a triangle uses it
+};
+
+class VertexGrid {
+public:
+    VertexGrid(const glm::vec3& lo, const glm::vec3& hi, unsigned int gridCells) : lo(lo) {
+        glm::vec3 extent = hi - lo;
+        float longest = std::max(extent.x, std::max(extent.y, extent.z));
+        inverseCellSize = longest > 0.0f ? float(gridCells) / longest : 0.0f;
+        for (int axis = 0; axis < 3; ++axis) {
+            dims[axis] = std::max(1u, std::min(gridCells, unsigned(std::ceil(extent[axis] * inverseCellSize))));
+        }
+        slots.assign(size_t(dims[0]) * dims[1] * dims[2], NO_SLOT);
+    }
+
+    // Slot of the cluster holding p, created on first use.
+    unsigned int slotOf(const glm::vec3& p) {
+        size_t cell = 0;
+        for (int axis = 2; axis >= 0; --axis) {
+            unsigned int c = std::min(dims[axis] - 1, unsigned(std::max(0.0f, (p[axis] - lo[axis]) * inverseCellSize)));
+            cell = cell * dims[axis] + c;
+        }
+        if (slots[cell] == NO_SLOT) {
+            slots[cell] = static_cast<unsigned int>(clusters.size());
+            clusters.emplace_back();
+        }
+        return slots[cell];
+    }
+
+    std::vector<Cluster> clusters;
+
+private:
+    glm::vec3 lo;
+    float inverseCellSize = 0.0f;
+    unsigned int dims[3] = { 1, 1, 1 };
+    std::vector<unsigned int> slots;
+};
+
+// Rotated so the smallest slot comes first, which keeps the winding; equal
+// triangles then pack to equal keys.
+uint64_t triangleKey(unsigned int a, unsigned int b, unsigned int c) {
+    if (b < a && b < c) {
+        unsigned int first = b;
+        b = c;
+        c = a;
+        a = first;
+    }
+    else if (c < a && c < b) {
+        unsigned int first = c;
+        c = b;
+        b = a;
+        a = first;
+    }
+    return (uint64_t(a) << 42) | (uint64_t(b) << 21) | uint64_t(c);
+}
+
+}  // namespace
+
+
+void buildPreviewMesh(const MeshData& meshData, unsigned int gridCells, MeshData& preview) {
+    preview.clear();
+    preview.materials = meshData.materials;
+    const Vertex* vertices = meshData.vertexData();
+    const unsigned int* indices = meshData.indexData();
+    size_t vertexCount = meshData.vertexCount();
+    if (vertexCount == 0) {
+        preview.computeBounds();
+        return;
+    }
+
+    glm::vec3 lo = vertices[0].Position, hi = lo;
+    for (size_t v = 1; v < vertexCount; ++v) {
+        lo = glm::min(lo, vertices[v].Position);
+        hi = glm::max(hi, vertices[v].Position);
+    }
+    VertexGrid grid(lo, hi, std::max(1u, std::min(gridCells, MAX_GRID_CELLS)));
+    for (size_t v = 0; v < vertexCount; ++v) {
+        Cluster& cluster = grid.clusters[grid.slotOf(vertices[v].Position)];
+        cluster.positionSum += vertices[v].Position;
+        cluster.normalSum += vertices[v].Normal;
+        ++cluster.count;
+    }
+
+    // (material, triangle) pairs; sorting groups the materials and brings
+    // duplicates together.
+    std::vector<std::pair<int, uint64_t>> triangles;
+    auto addRange = [&](size_t first, size_t count, int materialId) {
+        for (size_t i = first; i + 3 <= first + count; i += 3) {
+            unsigned int a = grid.slotOf(vertices[indices[i]].Position);
+            unsigned int b = grid.slotOf(vertices[indices[i + 1]].Position);
+            unsigned int c = grid.slotOf(vertices[indices[i + 2]].Position);
+            if (a != b && b != c && c != a) triangles.emplace_back(materialId, triangleKey(a, b, c));
+        }
+    };
+    if (meshData.submeshes.empty()) {
+        addRange(0, meshData.baseIndexCount(), -1);
+    }
+    else {
+        for (const Submesh& submesh : meshData.submeshes) addRange(submesh.indexOffset, submesh.indexCount, submesh.materialId);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+    preview.indices.reserve(3 * triangles.size());
+    for (size_t first = 0; first < triangles.size();) {
+        Submesh submesh;
+        submesh.indexOffset = static_cast<unsigned int>(preview.indices.size());
+        submesh.materialId = triangles[first].first;
+        size_t end = first;
+        for (; end < triangles.size() && triangles[end].first == submesh.materialId; ++end) {
+            uint64_t key = triangles[end].second;
+            const unsigned int corners[3] = { unsigned(key >> 42), unsigned(key >> 21) & 0x1FFFFFu, unsigned(key) & 0x1FFFFFu };
+            for (unsigned int slot : corners) {
+                Cluster& cluster = grid.clusters[slot];
+                if (cluster.vertex == NO_SLOT) {
+                    cluster.vertex = static_cast<unsigned int>(preview.vertices.size());
+                    Vertex vertex;
+                    vertex.Position = cluster.positionSum / float(cluster.count);
+                    float length = glm::length(cluster.normalSum);
+                    vertex.Normal = length > 0.0f ? cluster.normalSum / length : glm::vec3(0.0f, 1.0f, 0.0f);
+                    preview.vertices.push_back(vertex);
+                }
+                preview.indices.push_back(cluster.vertex);
+                if (preview.indices.size() == submesh.indexOffset + 1) {
+                    submesh.boundsMin = submesh.boundsMax = preview.vertices[cluster.vertex].Position;
+                }
+                submesh.boundsMin = glm::min(submesh.boundsMin, preview.vertices[cluster.vertex].Position);
+                submesh.boundsMax = glm::max(submesh.boundsMax, preview.vertices[cluster.vertex].Position);
+            }
+        }
+        submesh.indexCount = static_cast<unsigned int>(preview.indices.size() - submesh.indexOffset);
+        if (!meshData.submeshes.empty()) preview.submeshes.push_back(submesh);
+        first = end;
+    }
+    preview.computeBounds();
+}
@@ -0,0 +1,16 @@
+#ifndef MESH_PREVIEW_H
+#define MESH_PREVIEW_H
+
+#include "mesh.h"
+
+// Coarse stand-in for a mesh by vertex clustering (Rossignac & Borrel,
+// "Multi-resolution 3D approximations for rendering complex scenes", 1993):
+// a grid of gridCells cells along the longest side of the bounding box
+// (at most 128) merges the vertices in each cell into one at their average
+// position and normal. Triangles that collapse are dropped, duplicates are
+// kept once, and the rest are grouped into one submesh per material. One
+// pass over the vertices and one over the full-resolution triangles, so it
+// is cheap next to the other load passes even for very large meshes.
+void buildPreviewMesh(const MeshData& meshData, unsigned int gridCells, MeshData& preview);
+
+#endif
@@ -0,0 +1,345 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "vertex_cache.h"
+
+namespace {
+
+const size_t MAX_MESHLET_VERTICES = 64;
+const size_t MAX_MESHLET_TRIANGLES = 124;
+
+// How much a candidate's normal leaning away from the meshlet's mean counts
+// against it, in new vertices: a triangle turned 90 degrees costs as much as
+// one more vertex.
+const float CONE_WEIGHT = 1.0f;
+
+// A triangle that doesn't touch the meshlet joins it only if it faces
+// within about 45 degrees of the meshlet's mean normal.
+const float LOOSE_MIN_ALIGNMENT = 0.7f;
+
+// A cone wider than this (cosine of the widest normal to the axis) can't
+// cull anything worth the test.
+const float MIN_CONE_SPREAD = 0.1f;
+
+class MeshletBuilder {
+public:
+    MeshletBuilder(const unsigned int* indices, size_t triangleCount, const Vertex* vertices, size_t vertexCount)
+        : indices(indices), vertices(vertices), normals(triangleCount), taken(triangleCount, 0),
+          firstTriangle(vertexCount + 1, 0), liveCount(vertexCount, 0), vertexStamp(vertexCount, 0) {
+        for (size_t t = 0; t < triangleCount; ++t) {
+            const glm::vec3& a = vertices[indices[3 * t]].Position;
+            const glm::vec3& b = vertices[indices[3 * t + 1]].Position;
+            const glm::vec3& c = vertices[indices[3 * t + 2]].Position;
+            glm::vec3 cross = glm::cross(b - a, c - a);
+            float length = glm::length(cross);
+            normals[t] = length > 0.0f ? cross / length : glm::vec3(0.0f);
+            for (int k = 0; k < 3; ++k) ++liveCount[indices[3 * t + k]];
+        }
+        for (size_t v = 0; v < vertexCount; ++v) firstTriangle[v + 1] = firstTriangle[v] + liveCount[v];
+        adjacency.resize(firstTriangle[vertexCount]);
+        std::vector<unsigned int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (int k = 0; k < 3; ++k) adjacency[fill[indices[3 * t + k]]++] = static_cast<unsigned int>(t);
+        }
+    }
+
+    // Splits triangles [begin, end) into meshlets, appending their triangles
+    // to order and the meshlets (offsets into order * 3) to meshlets.
+    void buildRange(size_t begin, size_t end, std::vector<unsigned int>& order, std::vector<Meshlet>& meshlets) {
+        std::vector<unsigned int> sweep = mortonOrder(begin, end);
+        size_t cursor = 0;
+        while (true) {
+            while (cursor < sweep.size() && taken[sweep[cursor]]) ++cursor;
+            if (cursor == sweep.size()) return;
+            size_t seed = sweep[cursor];
+
+            ++stamp;
+            meshletVertices.clear();
+            meshletTriangles.clear();
+            normalSum = glm::vec3(0.0f);
+            take(seed);
+            while (meshletTriangles.size() < MAX_MESHLET_TRIANGLES) {
+                size_t next = bestCandidate(begin, end);
+                if (next == end) {
+                    // Out of neighbours (split seams, loose pieces): carry on
+                    // with the next triangle along the curve if it is close
+                    // by and faces the same way.
+                    while (cursor < sweep.size() && taken[sweep[cursor]]) ++cursor;
+                    if (cursor == sweep.size() || !fitsLoosely(sweep[cursor])) break;
+                    next = sweep[cursor];
+                }
+                take(next);
+            }
+
+            Meshlet meshlet;
+            meshlet.indexOffset = static_cast<unsigned int>(3 * order.size());
+            meshlet.indexCount = static_cast<unsigned int>(3 * meshletTriangles.size());
+            order.insert(order.end(), meshletTriangles.begin(), meshletTriangles.end());
+            computeBounds(meshlet);
+            meshlets.push_back(meshlet);
+        }
+    }
+
+private:
+    // Triangles [begin, end) along a Z-order curve through their centroids,
+    // so neighbours in the list are neighbours in space.
+    std::vector<unsigned int> mortonOrder(size_t begin, size_t end) const {
+        std::vector<glm::vec3> centroids(end - begin);
+        glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+        for (size_t t = begin; t < end; ++t) {
+            glm::vec3 c = (vertices[indices[3 * t]].Position + vertices[indices[3 * t + 1]].Position +
+                           vertices[indices[3 * t + 2]].Position) / 3.0f;
+            centroids[t - begin] = c;
+            lo = glm::min(lo, c);
+            hi = glm::max(hi, c);
+        }
+        glm::vec3 extent = hi - lo;
+        float size = std::max(extent.x, std::max(extent.y, extent.z));
+        float scale = size > 0.0f ? 1023.0f / size : 0.0f;
+
+        std::vector<std::pair<uint32_t, unsigned int>> keyed(end - begin);
+        for (size_t t = begin; t < end; ++t) {
+            glm::vec3 q = (centroids[t - begin] - lo) * scale;
+            uint32_t code = 0;
+            for (int bit = 9; bit >= 0; --bit) {
+                for (int axis = 0; axis < 3; ++axis) code = (code << 1) | ((uint32_t(q[axis]) >> bit) & 1u);
+            }
+            keyed[t - begin] = std::make_pair(code, static_cast<unsigned int>(t));
+        }
+        std::sort(keyed.begin(), keyed.end());
+        std::vector<unsigned int> sorted(keyed.size());
+        for (size_t i = 0; i < keyed.size(); ++i) sorted[i] = keyed[i].second;
+        return sorted;
+    }
+
+    void take(size_t t) {
+        taken[t] = 1;
+        meshletTriangles.push_back(static_cast<unsigned int>(t));
+        normalSum += normals[t];
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = indices[3 * t + k];
+            if (vertexStamp[v] != stamp) {
+                vertexStamp[v] = stamp;
+                meshletVertices.push_back(v);
+                if (meshletVertices.size() == 1) meshletMin = meshletMax = vertices[v].Position;
+                meshletMin = glm::min(meshletMin, vertices[v].Position);
+                meshletMax = glm::max(meshletMax, vertices[v].Position);
+            }
+            // Swap t out of v's live triangles.
+            unsigned int* live = &adjacency[firstTriangle[v]];
+            unsigned int& count = liveCount[v];
+            for (unsigned int i = 0; i < count; ++i) {
+                if (live[i] == t) {
+                    live[i] = live[--count];
+                    break;
+                }
+            }
+        }
+    }
+
+    bool fitsLoosely(size_t t) const {
+        if (meshletVertices.size() + newVertices(t) > MAX_MESHLET_VERTICES) return false;
+        float length = glm::length(normalSum);
+        if (length <= 0.0f || glm::dot(normals[t], normalSum / length) < LOOSE_MIN_ALIGNMENT) return false;
+        glm::vec3 extent = meshletMax - meshletMin;
+        glm::vec3 slack(std::max(extent.x, std::max(extent.y, extent.z)));
+        for (int k = 0; k < 3; ++k) {
+            const glm::vec3& p = vertices[indices[3 * t + k]].Position;
+            for (int axis = 0; axis < 3; ++axis) {
+                if (p[axis] < meshletMin[axis] - slack[axis] || p[axis] > meshletMax[axis] + slack[axis]) return false;
+            }
+        }
+        return true;
+    }
+
+    size_t newVertices(size_t t) const {
+        size_t added = 0;
+        for (int k = 0; k < 3; ++k) added += vertexStamp[indices[3 * t + k]] != stamp;
+        return added;
+    }
+
+    // The untaken triangle of [begin, end) next to the meshlet that fits and
+    // scores best, or end if there is none.
+    size_t bestCandidate(size_t begin, size_t end) const {
+        float length = glm::length(normalSum);
+        glm::vec3 axis = length > 0.0f ? normalSum / length : glm::vec3(0.0f);
+        size_t best = end;
+        float bestScore = std::numeric_limits<float>::max();
+        for (unsigned int v : meshletVertices) {
+            const unsigned int* live = &adjacency[firstTriangle[v]];
+            for (unsigned int i = 0; i < liveCount[v]; ++i) {
+                unsigned int t = live[i];
+                if (t < begin || t >= end) continue;
+                size_t added = newVertices(t);
+                if (meshletVertices.size() + added > MAX_MESHLET_VERTICES) continue;
+                float score = float(added) + CONE_WEIGHT * (1.0f - glm::dot(normals[t], axis));
+                if (score < bestScore || (score == bestScore && t < best)) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+        return best;
+    }
+
+    void computeBounds(Meshlet& meshlet) const {
+        glm::vec3 lo = vertices[meshletVertices[0]].Position, hi = lo;
+        for (unsigned int v : meshletVertices) {
+            lo = glm::min(lo, vertices[v].Position);
+            hi = glm::max(hi, vertices[v].Position);
+        }
+        meshlet.center = 0.5f * (lo + hi);
+        float radiusSquared = 0.0f;
+        for (unsigned int v : meshletVertices) {
+            glm::vec3 d = vertices[v].Position - meshlet.center;
+            radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+        }
+        meshlet.radius = std::sqrt(radiusSquared);
+
+        float length = glm::length(normalSum);
+        if (length <= 0.0f) return;
+        glm::vec3 axis = normalSum / length;
+        float spread = 1.0f;
+        for (unsigned int t : meshletTriangles) {
+            if (normals[t] != glm::vec3(0.0f)) spread = std::min(spread, glm::dot(normals[t], axis));
+        }
+        if (spread <= MIN_CONE_SPREAD) return;
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = std::sqrt(1.0f - spread * spread);
+    }
+
+    const unsigned int* indices;
+    const Vertex* vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<unsigned char> taken;
+    // Live (untaken) triangles of each vertex: adjacency[firstTriangle[v]],
+    // liveCount[v] of them.
+    std::vector<unsigned int> firstTriangle;
+    std::vector<unsigned int> liveCount;
+    std::vector<unsigned int> adjacency;
+
+    // The meshlet being built; vertexStamp[v] == stamp marks its vertices.
+    std::vector<unsigned int> vertexStamp;
+    unsigned int stamp = 0;
+    std::vector<unsigned int> meshletVertices;
+    std::vector<unsigned int> meshletTriangles;
+    glm::vec3 normalSum = glm::vec3(0.0f);
+    glm::vec3 meshletMin = glm::vec3(0.0f);
+    glm::vec3 meshletMax = glm::vec3(0.0f);
+};
+
+// Sorts meshlets [firstMeshlet, end) and their stretches of order by the
+// mean incoming position (triangle number) of their triangles, so the
+// meshlets go out in about the order the triangles came in, e.g. the
+// overdraw order (overdraw.h).
+void keepIncomingOrder(std::vector<unsigned int>& order, std::vector<Meshlet>& meshlets, size_t firstMeshlet) {
+    size_t count = meshlets.size() - firstMeshlet;
+    if (count < 2) return;
+    std::vector<std::pair<double, size_t>> keyed(count);
+    for (size_t k = 0; k < count; ++k) {
+        const Meshlet& meshlet = meshlets[firstMeshlet + k];
+        double sum = 0.0;
+        for (size_t t = meshlet.indexOffset / 3; t < (meshlet.indexOffset + meshlet.indexCount) / 3; ++t) sum += order[t];
+        keyed[k] = std::make_pair(sum / double(meshlet.indexCount / 3), k);
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    unsigned int offset = meshlets[firstMeshlet].indexOffset;
+    std::vector<unsigned int> sortedOrder;
+    std::vector<Meshlet> sorted;
+    for (const auto& entry : keyed) {
+        Meshlet meshlet = meshlets[firstMeshlet + entry.second];
+        sortedOrder.insert(sortedOrder.end(), order.begin() + meshlet.indexOffset / 3,
+                           order.begin() + (meshlet.indexOffset + meshlet.indexCount) / 3);
+        meshlet.indexOffset = offset;
+        offset += meshlet.indexCount;
+        sorted.push_back(meshlet);
+    }
+    std::copy(sortedOrder.begin(), sortedOrder.end(), order.begin() + meshlets[firstMeshlet].indexOffset / 3);
+    std::copy(sorted.begin(), sorted.end(), meshlets.begin() + firstMeshlet);
+}
+
+}  // namespace
+
+
+size_t buildMeshlets(MeshData& meshData, bool keepTriangleOrder) {
+    meshData.meshlets.clear();
+    size_t triangleCount = meshData.baseIndexCount() / 3;
+    if (triangleCount == 0) return 0;
+
+    MeshletBuilder builder(meshData.indices.data(), triangleCount, meshData.vertexData(), meshData.vertexCount());
+    std::vector<unsigned int> order;
+    order.reserve(triangleCount);
+    if (meshData.submeshes.empty()) {
+        builder.buildRange(0, triangleCount, order, meshData.meshlets);
+        if (keepTriangleOrder) keepIncomingOrder(order, meshData.meshlets, 0);
+    }
+    else {
+        for (const Submesh& submesh : meshData.submeshes) {
+            size_t first = submesh.indexOffset / 3;
+            size_t firstMeshlet = meshData.meshlets.size();
+            builder.buildRange(first, first + submesh.indexCount / 3, order, meshData.meshlets);
+            if (keepTriangleOrder) keepIncomingOrder(order, meshData.meshlets, firstMeshlet);
+        }
+    }
+
+    // Submesh ranges are unchanged: each one's meshlets fill exactly its own
+    // stretch of order.
+    std::vector<unsigned int> reordered(3 * triangleCount);
+    for (size_t i = 0; i < order.size(); ++i) {
+        std::copy(meshData.indices.begin() + 3 * order[i], meshData.indices.begin() + 3 * order[i] + 3,
+                  reordered.begin() + 3 * i);
+    }
+    std::copy(reordered.begin(), reordered.end(), meshData.indices.begin());
+
+    // Growth order is patchy for the vertex cache; reorder inside each one.
+    std::vector<Submesh> ranges(meshData.meshlets.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        ranges[i].indexOffset = meshData.meshlets[i].indexOffset;
+        ranges[i].indexCount = meshData.meshlets[i].indexCount;
+    }
+    optimizeVertexCache(meshData.indices.data(), ranges, meshData.vertexCount());
+    return meshData.meshlets.size();
+}
+
+MeshletCuller::MeshletCuller(const glm::mat4& modelViewProjection, const glm::vec3& cameraPosition)
+    : cameraPosition(cameraPosition) {
+    // Gribb & Hartmann: each clip plane is the last row plus or minus one of
+    // the others, normalized so distances come out in mesh units.
+    const glm::mat4& m = modelViewProjection;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int side = 0; side < 2; ++side) {
+            float sign = side == 0 ? 1.0f : -1.0f;
+            glm::vec4 plane(m[0][3] + sign * m[0][axis], m[1][3] + sign * m[1][axis],
+                            m[2][3] + sign * m[2][axis], m[3][3] + sign * m[3][axis]);
+            float length = glm::length(glm::vec3(plane));
+            planes[2 * axis + side] = length > 0.0f ? plane / length : plane;
+        }
+    }
+}
+
+bool MeshletCuller::isVisible(const Meshlet& meshlet) const {
+    return isInFrustum(meshlet.center, meshlet.radius) &&
+           !facesAway(meshlet.center, meshlet.radius, meshlet.coneAxis, meshlet.coneCutoff);
+}
+
+bool MeshletCuller::isInFrustum(const glm::vec3& center, float radius) const {
+    for (const glm::vec4& plane : planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+    }
+    return true;
+}
+
+bool MeshletCuller::facesAway(const glm::vec3& center, float radius, const glm::vec3& coneAxis, float coneCutoff) const {
+    // Every triangle faces away when the view direction to any point of the
+    // bounding sphere stays inside the cone's complement.
+    if (coneCutoff >= 1.0f) return false;
+    glm::vec3 toCenter = center - cameraPosition;
+    return glm::dot(toCenter, coneAxis) >= coneCutoff * glm::length(toCenter) + radius;
+}
@@ -0,0 +1,49 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <cstddef>
+
+#include "mesh.h"
+
+// Regroups the triangles inside each submesh (all full-resolution triangles
+// if there are none) into meshlets and fills meshData.meshlets. Seeds are
+// taken along a Z-order curve through the triangle centroids; a meshlet then
+// grows one neighbouring triangle at a time, preferring triangles that add
+// few new vertices and face the way the meshlet already does, so its normal
+// cone stays narrow. Where it runs out of neighbours (split vertices, loose
+// pieces) it may continue with the next nearby triangle along the curve.
+// The meshlets of a submesh follow the curve, which keeps the vertices they
+// use close together. With keepTriangleOrder they keep about the order their
+// triangles came in instead (by the mean position of those), so that an
+// overdraw order (overdraw.h) survives at meshlet granularity. Each meshlet
+// is then ordered for the vertex cache on its own (vertex_cache.h).
+//
+// meshData.indices must hold the indices (not a mapping). LOD levels are
+// left alone. Returns the number of meshlets.
+size_t buildMeshlets(MeshData& meshData, bool keepTriangleOrder = false);
+
+// Per-frame meshlet culling against the view frustum and, by normal cone,
+// against the camera seeing only back faces. isVisible is only right when
+// back faces are culled anyway (GL_CULL_FACE); use isInFrustum alone for
+// open meshes drawn two-sided. Assumes the model matrix scales uniformly.
+class MeshletCuller {
+public:
+    // modelViewProjection takes mesh space to clip space; cameraPosition is
+    // in mesh space.
+    MeshletCuller(const glm::mat4& modelViewProjection, const glm::vec3& cameraPosition);
+
+    bool isVisible(const Meshlet& meshlet) const;
+
+    // The two halves of isVisible, for other clusters with a bounding sphere
+    // and normal cone (coneCutoff >= 1 = no cone).
+    bool isInFrustum(const glm::vec3& center, float radius) const;
+    bool facesAway(const glm::vec3& center, float radius, const glm::vec3& coneAxis, float coneCutoff) const;
+
+    const glm::vec3& viewPosition() const { return cameraPosition; }
+
+private:
+    glm::vec4 planes[6];
+    glm::vec3 cameraPosition;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "normal_gen.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+namespace {
+
+// Splits [0, count) into one contiguous range per worker.
+void parallelFor(size_t count, unsigned int threads, const std::function<void(size_t, size_t)>& work) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t minPerThread = 16384;
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, (count + minPerThread - 1) / minPerThread));
+    if (threads <= 1) {
+        work(0, count);
+        return;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    size_t step = (count + threads - 1) / threads;
+    for (unsigned int i = 1; i < threads; ++i) {
+        size_t begin = std::min(count, i * step);
+        size_t end = std::min(count, begin + step);
+        workers.emplace_back(work, begin, end);
+    }
+    work(0, std::min(count, step));
+    for (std::thread& worker : workers) worker.join();
+}
+
+float cornerAngle(const glm::vec3& at, const glm::vec3& a, const glm::vec3& b) {
+    glm::vec3 e0 = a - at, e1 = b - at;
+    float len = std::sqrt(glm::dot(e0, e0) * glm::dot(e1, e1));
+    if (len <= 0.0f) return 0.0f;
+    return std::acos(std::max(-1.0f, std::min(1.0f, glm::dot(e0, e1) / len)));
+}
+
+}  // namespace
+
+
+NormalGenStats generateNormals(MeshData& meshData, const NormalGenOptions& options,
+                               const std::vector<unsigned int>& triangleSmoothingGroups) {
+    NormalGenStats stats;
+    std::vector<Vertex>& vertices = meshData.vertices;
+    std::vector<unsigned int>& indices = meshData.indices;
+    size_t vertexCount = vertices.size();
+    size_t triangleCount = indices.size() / 3;
+
+    std::vector<unsigned char> needsNormal(vertexCount, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        const glm::vec3& n = vertices[v].Normal;
+        if (n.x == 0.0f && n.y == 0.0f && n.z == 0.0f) {
+            needsNormal[v] = 1;
+            ++stats.generated;
+        }
+    }
+    if (stats.generated == 0 || triangleCount == 0) return stats;
+
+    // Unit face normals; the cross product length (twice the area) is kept
+    // separately for area weighting.
+    std::vector<glm::vec3> faceNormals(triangleCount);
+    std::vector<float> faceAreas(triangleCount);
+    parallelFor(triangleCount, options.threads, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            const glm::vec3& p0 = vertices[indices[3 * t + 0]].Position;
+            const glm::vec3& p1 = vertices[indices[3 * t + 1]].Position;
+            const glm::vec3& p2 = vertices[indices[3 * t + 2]].Position;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float len = std::sqrt(glm::dot(n, n));
+            faceNormals[t] = (len > 0.0f) ? n / len : glm::vec3(0.0f);
+            faceAreas[t] = len;
+        }
+    });
+
+    // Vertex -> incident corner lists (CSR), restricted to vertices that need
+    // a normal, so every worker can sum its own vertices without atomics.
+    std::vector<size_t> cornerStart(vertexCount + 1, 0);
+    for (size_t c = 0; c < indices.size(); ++c) {
+        if (needsNormal[indices[c]]) ++cornerStart[indices[c] + 1];
+    }
+    for (size_t v = 0; v < vertexCount; ++v) cornerStart[v + 1] += cornerStart[v];
+    std::vector<size_t> incident(cornerStart[vertexCount]);
+    {
+        std::vector<size_t> fill(cornerStart.begin(), cornerStart.end() - 1);
+        for (size_t c = 0; c < indices.size(); ++c) {
+            if (needsNormal[indices[c]]) incident[fill[indices[c]]++] = c;
+        }
+    }
+
+    bool useGroups = options.useSmoothingGroups && triangleSmoothingGroups.size() == triangleCount;
+    bool splitting = useGroups || options.creaseAngle < 180.0f;
+    float cosCrease = std::cos(options.creaseAngle * 3.14159265358979f / 180.0f);
+
+    auto cornerWeight = [&](size_t c) {
+        size_t t = c / 3;
+        if (options.weighting == NormalGenOptions::AREA) return faceAreas[t];
+        const glm::vec3& at = vertices[indices[c]].Position;
+        const glm::vec3& a = vertices[indices[3 * t + (c + 1) % 3]].Position;
+        const glm::vec3& b = vertices[indices[3 * t + (c + 2) % 3]].Position;
+        return cornerAngle(at, a, b);
+    };
+    auto compatible = [&](size_t t, size_t u) {
+        if (t == u) return true;
+        if (useGroups) {
+            unsigned int group = triangleSmoothingGroups[t];
+            if (group == 0 || triangleSmoothingGroups[u] != group) return false;
+        }
+        return glm::dot(faceNormals[t], faceNormals[u]) >= cosCrease;
+    };
+    auto finish = [](const glm::vec3& sum, const glm::vec3& fallback) {
+        float len = std::sqrt(glm::dot(sum, sum));
+        if (len > 0.0f) return sum / len;
+        float fallbackLen = std::sqrt(glm::dot(fallback, fallback));
+        return (fallbackLen > 0.0f) ? fallback : glm::vec3(0.0f, 1.0f, 0.0f);
+    };
+
+    // Without splitting every corner of a vertex gets the same normal, so it
+    // is written straight into the vertex. Otherwise each corner's normal is
+    // computed from the incident faces compatible with its own face.
+    std::vector<glm::vec3> cornerNormals(splitting ? incident.size() : 0);
+    parallelFor(vertexCount, options.threads, [&](size_t begin, size_t end) {
+        std::vector<float> weights;
+        for (size_t v = begin; v < end; ++v) {
+            if (!needsNormal[v]) continue;
+            size_t first = cornerStart[v], last = cornerStart[v + 1];
+            weights.resize(last - first);
+            for (size_t i = first; i < last; ++i) weights[i - first] = cornerWeight(incident[i]);
+
+            if (!splitting) {
+                glm::vec3 sum(0.0f);
+                for (size_t i = first; i < last; ++i) sum += faceNormals[incident[i] / 3] * weights[i - first];
+                vertices[v].Normal = finish(sum, first < last ? faceNormals[incident[first] / 3] : glm::vec3(0.0f));
+                continue;
+            }
+            for (size_t i = first; i < last; ++i) {
+                size_t t = incident[i] / 3;
+                glm::vec3 sum(0.0f);
+                for (size_t j = first; j < last; ++j) {
+                    size_t u = incident[j] / 3;
+                    if (compatible(t, u)) sum += faceNormals[u] * weights[j - first];
+                }
+                cornerNormals[i] = finish(sum, faceNormals[t]);
+            }
+        }
+    });
+
+    if (splitting) {
+        // Corners of one vertex that ended up with identical normals share a
+        // vertex; every further distinct normal gets a copy appended.
+        std::vector<unsigned int> variants;
+        for (size_t v = 0; v < vertexCount; ++v) {
+            if (!needsNormal[v]) continue;
+            size_t first = cornerStart[v], last = cornerStart[v + 1];
+            if (first == last) {
+                vertices[v].Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+                continue;
+            }
+            variants.clear();
+            vertices[v].Normal = cornerNormals[first];
+            variants.push_back(static_cast<unsigned int>(v));
+            for (size_t i = first + 1; i < last; ++i) {
+                const glm::vec3& n = cornerNormals[i];
+                unsigned int target = 0;
+                bool found = false;
+                for (unsigned int candidate : variants) {
+                    if (vertices[candidate].Normal == n) {
+                        target = candidate;
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found) {
+                    Vertex copy = vertices[v];
+                    copy.Normal = n;
+                    target = static_cast<unsigned int>(vertices.size());
+                    vertices.push_back(copy);
+                    variants.push_back(target);
+                    ++stats.splitVertices;
+                }
+                indices[incident[i]] = target;
+            }
+        }
+    }
+    else {
+        // Vertices no triangle references keep a usable placeholder.
+        for (size_t v = 0; v < vertexCount; ++v) {
+            if (needsNormal[v] && cornerStart[v] == cornerStart[v + 1]) vertices[v].Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    return stats;
+}
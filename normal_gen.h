@@ -0,0 +1,26 @@
+#ifndef NORMAL_GEN_H
+#define NORMAL_GEN_H
+
+#include <cstddef>
+#include <vector>
+
+#include "mesh.h"
+
+struct NormalGenStats {
+    size_t generated = 0;      // vertices that received a computed normal
+    size_t splitVertices = 0;  // extra vertices created at creases / group borders
+};
+
+// Fills in Vertex::Normal for every vertex whose normal is zero (the loaders
+// leave it that way when the OBJ has no usable vn). Face normals are
+// accumulated per vertex with angle or area weights, in parallel over
+// vertices. With a crease angle below 180 degrees or smoothing groups
+// enabled, a vertex whose incident faces disagree is split into one copy per
+// distinct normal and the affected indices are rewritten.
+//
+// triangleSmoothingGroups is optional (one id per triangle, as in
+// tinyobj::mesh_t::smoothing_group_ids); id 0 means "s off", i.e. flat.
+NormalGenStats generateNormals(MeshData& meshData, const NormalGenOptions& options,
+                               const std::vector<unsigned int>& triangleSmoothingGroups = std::vector<unsigned int>());
+
+#endif
@@ -0,0 +1,865 @@
+#include "obj_parser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "inflate_stream.h"
+#include "mapped_file.h"
+#include "obj_scan.h"
+
+namespace {
+
+// Files smaller than this per thread are not worth splitting further.
+const size_t MIN_CHUNK_BYTES = 1 << 20;
+
+// Decompressed text each thread gets per segment of a gzip file; two
+// segments are held at once.
+const size_t GZIP_SEGMENT_BYTES_PER_THREAD = 4 * MIN_CHUNK_BYTES;
+
+enum ObjEventType { EVENT_GROUP, EVENT_OBJECT, EVENT_USEMTL, EVENT_SMOOTHING };
+
+// A record that changes shape/material state, positioned between faces.
+struct ObjEvent {
+    ObjEventType type;
+    size_t face;              // faces parsed in the chunk before this record
+    std::string name;
+    unsigned int smoothingId;
+};
+
+struct ObjChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+
+    std::vector<tinyobj::real_t> positions;
+    std::vector<tinyobj::real_t> normals;
+    std::vector<tinyobj::real_t> texcoords;
+
+    // Zero-based corners. Relative (negative) OBJ indices are stored relative
+    // to the start of the chunk and listed in relativeSlots until the prefix
+    // sum over earlier chunks is known.
+    std::vector<tinyobj::index_t> corners;
+    std::vector<unsigned int> faceSizes;
+    std::vector<size_t> relativeSlots;  // corner * 3 + component (0 = v, 1 = vn, 2 = vt)
+    std::vector<ObjEvent> events;
+    std::vector<std::string> mtllibs;
+
+    size_t lineCount = 0;
+    size_t errorLine = 0;  // chunk-local, 1-based; 0 = no error
+    std::string error;
+    std::string warning;
+
+    size_t vertexBase = 0;
+    size_t normalBase = 0;
+    size_t texcoordBase = 0;
+
+    // Triangle list after fixup; unused when every face already was a triangle.
+    std::vector<tinyobj::index_t> triangles;
+    bool cornersAreTriangles = true;
+    std::vector<size_t> eventTriangle;  // triangles emitted before each event
+};
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+inline bool isDigit(char c) { return static_cast<unsigned int>(c - '0') < 10u; }
+
+inline const char* skipSpace(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) ++p;
+    return p;
+}
+
+inline const char* skipSpaceOrCR(const char* p, const char* end) {
+    while (p < end && (isSpace(*p) || *p == '\r')) ++p;
+    return p;
+}
+
+inline const char* findTokenEnd(const char* p, const char* end) {
+    while (p < end && !isSpace(*p) && *p != '\r') ++p;
+    return p;
+}
+
+inline bool startsWith(const char* p, const char* end, const char* keyword, size_t length) {
+    return size_t(end - p) > length && std::memcmp(p, keyword, length) == 0 && isSpace(p[length]);
+}
+
+// Powers of ten and five used by tryParseDouble. The entries are produced by
+// the same literals / std::pow calls tinyobj evaluates per digit, so looking
+// them up gives exactly the same doubles.
+const int POW10_TABLE_SIZE = 32;
+const int POW5_TABLE_LIMIT = 64;
+
+struct PowerTables {
+    double negativePow10[POW10_TABLE_SIZE];        // 10^-i
+    double pow5[2 * POW5_TABLE_LIMIT + 1];         // 5^(e + POW5_TABLE_LIMIT)
+
+    PowerTables() {
+        static const double pow_lut[] = {
+            1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+        };
+        const int lut_entries = sizeof pow_lut / sizeof pow_lut[0];
+        for (int i = 0; i < POW10_TABLE_SIZE; ++i) {
+            negativePow10[i] = (i < lut_entries) ? pow_lut[i] : std::pow(10.0, -i);
+        }
+        for (int e = -POW5_TABLE_LIMIT; e <= POW5_TABLE_LIMIT; ++e) {
+            pow5[e + POW5_TABLE_LIMIT] = std::pow(5.0, e);
+        }
+    }
+};
+
+const PowerTables& powerTables() {
+    static const PowerTables tables;
+    return tables;
+}
+
+// Same grammar and arithmetic as tinyobj's tryParseDouble, so the parallel
+// path produces bit-identical values. Two shortcuts keep it exact: up to 15
+// integer digits are accumulated in an integer (every partial value is below
+// 2^53, where the double steps are exact too), and powers come from tables.
+bool tryParseDouble(const char* s, const char* s_end, double* result) {
+    if (s >= s_end) return false;
+
+    const PowerTables& tables = powerTables();
+    double mantissa = 0.0;
+    int exponent = 0;
+    char sign = '+';
+    char exp_sign = '+';
+    const char* curr = s;
+    int read = 0;
+    bool end_not_reached = false;
+    bool leading_decimal_dots = false;
+
+    if (*curr == '+' || *curr == '-') {
+        sign = *curr;
+        curr++;
+        if ((curr != s_end) && (*curr == '.')) leading_decimal_dots = true;
+    }
+    else if (isDigit(*curr)) {
+    }
+    else if (*curr == '.') {
+        leading_decimal_dots = true;
+    }
+    else {
+        return false;
+    }
+
+    end_not_reached = (curr != s_end);
+    if (!leading_decimal_dots) {
+        uint64_t integer = 0;
+        while (end_not_reached && read < 15 && isDigit(*curr)) {
+            integer = integer * 10 + static_cast<uint64_t>(*curr - 0x30);
+            curr++;
+            read++;
+            end_not_reached = (curr != s_end);
+        }
+        mantissa = static_cast<double>(integer);
+        while (end_not_reached && isDigit(*curr)) {
+            mantissa *= 10;
+            mantissa += static_cast<int>(*curr - 0x30);
+            curr++;
+            read++;
+            end_not_reached = (curr != s_end);
+        }
+        if (read == 0) return false;
+    }
+
+    if (!end_not_reached) goto assemble;
+
+    if (*curr == '.') {
+        curr++;
+        read = 1;
+        end_not_reached = (curr != s_end);
+        while (end_not_reached && isDigit(*curr)) {
+            mantissa += static_cast<int>(*curr - 0x30) *
+                        (read < POW10_TABLE_SIZE ? tables.negativePow10[read] : std::pow(10.0, -read));
+            read++;
+            curr++;
+            end_not_reached = (curr != s_end);
+        }
+    }
+    else if (*curr == 'e' || *curr == 'E') {
+    }
+    else {
+        goto assemble;
+    }
+
+    if (!end_not_reached) goto assemble;
+
+    if (*curr == 'e' || *curr == 'E') {
+        curr++;
+        end_not_reached = (curr != s_end);
+        if (end_not_reached && (*curr == '+' || *curr == '-')) {
+            exp_sign = *curr;
+            curr++;
+        }
+        else if (end_not_reached && isDigit(*curr)) {
+        }
+        else {
+            return false;
+        }
+
+        read = 0;
+        end_not_reached = (curr != s_end);
+        while (end_not_reached && isDigit(*curr)) {
+            if (exponent > (2147483647 / 10)) return false;
+            exponent *= 10;
+            exponent += static_cast<int>(*curr - 0x30);
+            curr++;
+            read++;
+            end_not_reached = (curr != s_end);
+        }
+        exponent *= (exp_sign == '+' ? 1 : -1);
+        if (read == 0) return false;
+    }
+
+assemble:
+    if (exponent == 0) {
+        *result = (sign == '+' ? 1 : -1) * mantissa;
+    }
+    else {
+        double pow5 = (exponent >= -POW5_TABLE_LIMIT && exponent <= POW5_TABLE_LIMIT)
+            ? tables.pow5[exponent + POW5_TABLE_LIMIT] : std::pow(5.0, exponent);
+        *result = (sign == '+' ? 1 : -1) * std::ldexp(mantissa * pow5, exponent);
+    }
+    return true;
+}
+
+// Set by setObjScannerSimd(); only changed while no parse is running.
+bool useSimdScan = true;
+
+// readLimit is the end of the addressable buffer, which lets the token end
+// be found with one 16-byte compare instead of a byte loop.
+inline tinyobj::real_t parseReal(const char*& token, const char* end, const char* readLimit) {
+    token = skipSpace(token, end);
+    const char* tokenEnd;
+    if (useSimdScan && readLimit - token >= 16) {
+        unsigned int offset = objscan::delimiterOffset16(token);
+        tokenEnd = (offset < 16) ? std::min(token + offset, end) : findTokenEnd(token + 16, end);
+        if (tokenEnd > end) tokenEnd = end;
+    }
+    else {
+        tokenEnd = findTokenEnd(token, end);
+    }
+    double value = 0.0;
+    tryParseDouble(token, tokenEnd, &value);
+    token = tokenEnd;
+    return static_cast<tinyobj::real_t>(value);
+}
+
+// atoi() on a non-terminated buffer.
+inline int parseInt(const char* p, const char* end) {
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        ++p;
+    }
+    long long value = 0;
+    while (p < end && isDigit(*p)) {
+        if (value < 2147483648ll) value = value * 10 + (*p - '0');
+        ++p;
+    }
+    if (negative) value = -value;
+    return static_cast<int>(std::max(-2147483647ll - 1, std::min(value, 2147483647ll)));
+}
+
+inline const char* skipIndexToken(const char* p, const char* end) {
+    while (p < end && *p != '/' && !isSpace(*p) && *p != '\r') ++p;
+    return p;
+}
+
+// Makes one raw OBJ index zero-based; 0 (absent) becomes -1.
+inline void fixIndex(ObjChunk& chunk, int raw, size_t localCount, size_t slot, int& out) {
+    if (raw > 0) {
+        out = raw - 1;
+    }
+    else if (raw == 0) {
+        out = -1;
+    }
+    else {
+        out = static_cast<int>(static_cast<long long>(localCount) + raw);
+        chunk.relativeSlots.push_back(slot);
+    }
+}
+
+// i, i/j, i//k, i/j/k
+bool parseCorner(ObjChunk& chunk, const char*& token, const char* end) {
+    size_t corner = chunk.corners.size();
+    tinyobj::index_t idx;
+    idx.vertex_index = -1;
+    idx.normal_index = -1;
+    idx.texcoord_index = -1;
+
+    int raw = parseInt(token, end);
+    if (raw == 0) return false;
+    fixIndex(chunk, raw, chunk.positions.size() / 3, corner * 3 + 0, idx.vertex_index);
+    token = skipIndexToken(token, end);
+
+    if (token < end && *token == '/') {
+        ++token;
+        if (token < end && *token == '/') {
+            ++token;
+            fixIndex(chunk, parseInt(token, end), chunk.normals.size() / 3, corner * 3 + 1, idx.normal_index);
+            token = skipIndexToken(token, end);
+        }
+        else {
+            fixIndex(chunk, parseInt(token, end), chunk.texcoords.size() / 2, corner * 3 + 2, idx.texcoord_index);
+            token = skipIndexToken(token, end);
+            if (token < end && *token == '/') {
+                ++token;
+                fixIndex(chunk, parseInt(token, end), chunk.normals.size() / 3, corner * 3 + 1, idx.normal_index);
+                token = skipIndexToken(token, end);
+            }
+        }
+    }
+
+    chunk.corners.push_back(idx);
+    return true;
+}
+
+bool parseLine(ObjChunk& chunk, const char* token, const char* end) {
+    token = skipSpace(token, end);
+    if (token >= end || *token == '#') return true;
+
+    if (startsWith(token, end, "v", 1)) {
+        token += 2;
+        tinyobj::real_t x = parseReal(token, end, chunk.end);
+        tinyobj::real_t y = parseReal(token, end, chunk.end);
+        tinyobj::real_t z = parseReal(token, end, chunk.end);
+        chunk.positions.push_back(x);
+        chunk.positions.push_back(y);
+        chunk.positions.push_back(z);
+        return true;
+    }
+
+    if (startsWith(token, end, "vn", 2)) {
+        token += 3;
+        tinyobj::real_t x = parseReal(token, end, chunk.end);
+        tinyobj::real_t y = parseReal(token, end, chunk.end);
+        tinyobj::real_t z = parseReal(token, end, chunk.end);
+        chunk.normals.push_back(x);
+        chunk.normals.push_back(y);
+        chunk.normals.push_back(z);
+        return true;
+    }
+
+    if (startsWith(token, end, "vt", 2)) {
+        token += 3;
+        tinyobj::real_t u = parseReal(token, end, chunk.end);
+        tinyobj::real_t v = parseReal(token, end, chunk.end);
+        chunk.texcoords.push_back(u);
+        chunk.texcoords.push_back(v);
+        return true;
+    }
+
+    if (startsWith(token, end, "f", 1)) {
+        token = skipSpace(token + 2, end);
+        unsigned int count = 0;
+        while (token < end && *token != '#') {
+            if (!parseCorner(chunk, token, end)) {
+                chunk.error = "Failed to parse `f' line (e.g. a zero value for vertex index)";
+                return false;
+            }
+            ++count;
+            token = skipSpaceOrCR(token, end);
+        }
+        chunk.faceSizes.push_back(count);
+        return true;
+    }
+
+    if (size_t(end - token) >= 6 && std::memcmp(token, "usemtl", 6) == 0) {
+        token = skipSpace(token + 6, end);
+        ObjEvent event;
+        event.type = EVENT_USEMTL;
+        event.face = chunk.faceSizes.size();
+        event.name.assign(token, findTokenEnd(token, end));
+        event.smoothingId = 0;
+        chunk.events.push_back(event);
+        return true;
+    }
+
+    if (startsWith(token, end, "mtllib", 6)) {
+        token += 7;
+        for (;;) {
+            token = skipSpace(token, end);
+            if (token >= end) break;
+            const char* nameEnd = findTokenEnd(token, end);
+            if (nameEnd == token) break;
+            chunk.mtllibs.push_back(std::string(token, nameEnd));
+            token = nameEnd;
+        }
+        // An empty string separates the alternatives of consecutive mtllib lines.
+        chunk.mtllibs.push_back(std::string());
+        return true;
+    }
+
+    if (startsWith(token, end, "g", 1) || startsWith(token, end, "o", 1)) {
+        ObjEvent event;
+        event.type = (token[0] == 'g') ? EVENT_GROUP : EVENT_OBJECT;
+        event.face = chunk.faceSizes.size();
+        event.smoothingId = 0;
+        if (event.type == EVENT_OBJECT) {
+            event.name.assign(token + 2, end);
+        }
+        else {
+            // Multiple group names are joined with a space, as tinyobj does.
+            token += 2;
+            for (;;) {
+                token = skipSpaceOrCR(token, end);
+                if (token >= end || *token == '#') break;
+                const char* nameEnd = findTokenEnd(token, end);
+                if (!event.name.empty()) event.name += ' ';
+                event.name.append(token, nameEnd);
+                token = nameEnd;
+            }
+        }
+        chunk.events.push_back(event);
+        return true;
+    }
+
+    if (startsWith(token, end, "s", 1)) {
+        token = skipSpace(token + 2, end);
+        if (token >= end || *token == '\r') return true;
+        ObjEvent event;
+        event.type = EVENT_SMOOTHING;
+        event.face = chunk.faceSizes.size();
+        if (end - token >= 3 && std::memcmp(token, "off", 3) == 0) {
+            event.smoothingId = 0;
+        }
+        else {
+            int id = parseInt(token, end);
+            event.smoothingId = id < 0 ? 0u : static_cast<unsigned int>(id);
+        }
+        chunk.events.push_back(event);
+        return true;
+    }
+
+    // Ignore everything else (l, p, vw, t, ...).
+    return true;
+}
+
+bool parseChunkLine(ObjChunk& chunk, const char* p, const char* lineEnd) {
+    ++chunk.lineCount;
+    if (lineEnd > p && lineEnd[-1] == '\r') --lineEnd;
+    if (!parseLine(chunk, p, lineEnd)) {
+        chunk.errorLine = chunk.lineCount;
+        return false;
+    }
+    return true;
+}
+
+void parseChunk(ObjChunk& chunk) {
+    const char* p = chunk.begin;
+
+    // Newlines are located 64 bytes at a time; each set bit of the mask ends
+    // one line, so short lines never pay for a memchr call of their own.
+    if (useSimdScan) {
+        const char* block = chunk.begin;
+        while (chunk.end - block >= 64) {
+            uint64_t mask = objscan::newlineMask64(block);
+            while (mask) {
+                const char* newline = block + objscan::countTrailingZeros(mask);
+                mask &= mask - 1;
+                if (!parseChunkLine(chunk, p, newline)) return;
+                p = newline + 1;
+            }
+            block += 64;
+        }
+    }
+
+    while (p < chunk.end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', size_t(chunk.end - p)));
+        const char* lineEnd = newline ? newline : chunk.end;
+        if (!parseChunkLine(chunk, p, lineEnd)) return;
+        p = newline ? newline + 1 : chunk.end;
+    }
+}
+
+// Resolves relative indices against the chunk bases and triangulates.
+void fixupChunk(ObjChunk& chunk, const std::vector<tinyobj::real_t>& positions) {
+    for (size_t slot : chunk.relativeSlots) {
+        tinyobj::index_t& idx = chunk.corners[slot / 3];
+        int* value = (slot % 3 == 0) ? &idx.vertex_index : (slot % 3 == 1) ? &idx.normal_index : &idx.texcoord_index;
+        size_t base = (slot % 3 == 0) ? chunk.vertexBase : (slot % 3 == 1) ? chunk.normalBase : chunk.texcoordBase;
+        long long absolute = static_cast<long long>(*value) + static_cast<long long>(base);
+        if (absolute < 0) {
+            if (chunk.error.empty()) chunk.error = "Invalid relative index in `f' line";
+            absolute = -1;
+        }
+        *value = static_cast<int>(absolute);
+    }
+    chunk.relativeSlots.clear();
+
+    for (unsigned int n : chunk.faceSizes) {
+        if (n != 3) {
+            chunk.cornersAreTriangles = false;
+            break;
+        }
+    }
+
+    chunk.eventTriangle.resize(chunk.events.size());
+    if (chunk.cornersAreTriangles) {
+        for (size_t e = 0; e < chunk.events.size(); ++e) chunk.eventTriangle[e] = chunk.events[e].face;
+        return;
+    }
+
+    size_t vertexCount = positions.size() / 3;
+    size_t corner = 0;
+    size_t nextEvent = 0;
+    chunk.triangles.reserve(chunk.corners.size());
+    for (size_t f = 0; f <= chunk.faceSizes.size(); ++f) {
+        while (nextEvent < chunk.events.size() && chunk.events[nextEvent].face == f) {
+            chunk.eventTriangle[nextEvent++] = chunk.triangles.size() / 3;
+        }
+        if (f == chunk.faceSizes.size()) break;
+
+        unsigned int n = chunk.faceSizes[f];
+        const tinyobj::index_t* face = &chunk.corners[corner];
+        corner += n;
+
+        if (n < 3) {
+            chunk.warning += "Degenerated face found\n.";
+            continue;
+        }
+        if (n == 3) {
+            chunk.triangles.insert(chunk.triangles.end(), face, face + 3);
+            continue;
+        }
+        if (n == 4) {
+            bool valid = true;
+            for (int k = 0; k < 4; ++k) {
+                if (face[k].vertex_index < 0 || size_t(face[k].vertex_index) >= vertexCount) valid = false;
+            }
+            if (!valid) {
+                chunk.warning += "Face with invalid vertex index found.\n";
+                continue;
+            }
+            // Split along the shorter diagonal, like tinyobj.
+            const tinyobj::real_t* v0 = &positions[3 * size_t(face[0].vertex_index)];
+            const tinyobj::real_t* v1 = &positions[3 * size_t(face[1].vertex_index)];
+            const tinyobj::real_t* v2 = &positions[3 * size_t(face[2].vertex_index)];
+            const tinyobj::real_t* v3 = &positions[3 * size_t(face[3].vertex_index)];
+            tinyobj::real_t e02x = v2[0] - v0[0], e02y = v2[1] - v0[1], e02z = v2[2] - v0[2];
+            tinyobj::real_t e13x = v3[0] - v1[0], e13y = v3[1] - v1[1], e13z = v3[2] - v1[2];
+            tinyobj::real_t sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+            tinyobj::real_t sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+            const int split[2][6] = { { 0, 1, 2, 0, 2, 3 }, { 0, 1, 3, 1, 2, 3 } };
+            const int* order = split[sqr02 < sqr13 ? 0 : 1];
+            for (int k = 0; k < 6; ++k) chunk.triangles.push_back(face[order[k]]);
+            continue;
+        }
+        for (unsigned int k = 1; k + 1 < n; ++k) {
+            chunk.triangles.push_back(face[0]);
+            chunk.triangles.push_back(face[k]);
+            chunk.triangles.push_back(face[k + 1]);
+        }
+    }
+    std::vector<tinyobj::index_t>().swap(chunk.corners);
+}
+
+// Runs work on every chunk, on at most threadCount threads including this one.
+void runOnChunks(std::vector<ObjChunk>& chunks, unsigned int threadCount, const std::function<void(ObjChunk&)>& work) {
+    size_t workerCount = std::min<size_t>(threadCount, chunks.size());
+    if (workerCount <= 1) {
+        for (ObjChunk& chunk : chunks) work(chunk);
+        return;
+    }
+    std::atomic<size_t> next(0);
+    auto drain = [&chunks, &next, &work]() {
+        for (size_t i = next++; i < chunks.size(); i = next++) work(chunks[i]);
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount - 1);
+    for (size_t i = 1; i < workerCount; ++i) workers.emplace_back(drain);
+    drain();
+    for (std::thread& worker : workers) worker.join();
+}
+
+// Appends chunks covering data[0, size), split on newline boundaries into
+// one per thread (fewer for small buffers).
+void splitChunks(const char* data, size_t size, unsigned int threadCount, std::vector<ObjChunk>& chunks) {
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, size / MIN_CHUNK_BYTES));
+    const char* dataEnd = data + size;
+    const char* cursor = data;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        ObjChunk chunk;
+        chunk.begin = cursor;
+        if (i + 1 == chunkCount) {
+            cursor = dataEnd;
+        }
+        else {
+            const char* target = std::max(cursor, data + size * (i + 1) / chunkCount);
+            const char* newline = static_cast<const char*>(std::memchr(target, '\n', size_t(dataEnd - target)));
+            cursor = newline ? newline + 1 : dataEnd;
+        }
+        chunk.end = cursor;
+        chunks.push_back(std::move(chunk));
+    }
+}
+
+void loadMaterials(const std::vector<ObjChunk>& chunks, std::vector<tinyobj::material_t>* materials,
+                   std::map<std::string, int>& materialMap, const std::string& materialDir, std::string& warn,
+                   std::string& err) {
+    tinyobj::MaterialFileReader reader(materialDir);
+    std::set<std::string> loaded;
+    bool lineDone = false;
+    for (const ObjChunk& chunk : chunks) {
+        for (const std::string& filename : chunk.mtllibs) {
+            // The first file of each mtllib line that loads wins.
+            if (filename.empty()) {
+                lineDone = false;
+                continue;
+            }
+            if (lineDone) continue;
+            if (loaded.count(filename)) {
+                lineDone = true;
+                continue;
+            }
+            std::string mtlWarn, mtlErr;
+            if (reader(filename, materials, &materialMap, &mtlWarn, &mtlErr)) {
+                loaded.insert(filename);
+                lineDone = true;
+            }
+            warn += mtlWarn;
+            err += mtlErr;
+        }
+    }
+}
+
+void appendTriangles(tinyobj::shape_t& shape, const std::string& name, const std::vector<tinyobj::index_t>& triangles,
+                     size_t first, size_t last, int materialId, unsigned int smoothingId) {
+    if (first >= last) return;
+    if (shape.mesh.indices.empty()) shape.name = name;
+    shape.mesh.indices.insert(shape.mesh.indices.end(), triangles.begin() + 3 * first, triangles.begin() + 3 * last);
+    shape.mesh.num_face_vertices.insert(shape.mesh.num_face_vertices.end(), last - first, 3u);
+    shape.mesh.material_ids.insert(shape.mesh.material_ids.end(), last - first, materialId);
+    shape.mesh.smoothing_group_ids.insert(shape.mesh.smoothing_group_ids.end(), last - first, smoothingId);
+}
+
+// Everything after the per-chunk parse: error reporting, prefix sums over
+// the chunks (in file order), relative index fixup, materials and shapes.
+bool mergeChunks(std::vector<ObjChunk>& chunks, unsigned int threadCount, tinyobj::attrib_t* attrib,
+                 std::vector<tinyobj::shape_t>* shapes, std::vector<tinyobj::material_t>* materials,
+                 std::string* warn, std::string* err, const std::string& materialDir) {
+    size_t linesBefore = 0;
+    for (const ObjChunk& chunk : chunks) {
+        if (chunk.errorLine != 0) {
+            if (err) {
+                std::stringstream ss;
+                ss << chunk.error << ". Line " << (linesBefore + chunk.errorLine) << ".\n";
+                (*err) += ss.str();
+            }
+            return false;
+        }
+        linesBefore += chunk.lineCount;
+    }
+
+    // Prefix sums give every chunk the global offset of its attributes.
+    size_t vertexTotal = 0, normalTotal = 0, texcoordTotal = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.vertexBase = vertexTotal;
+        chunk.normalBase = normalTotal;
+        chunk.texcoordBase = texcoordTotal;
+        vertexTotal += chunk.positions.size() / 3;
+        normalTotal += chunk.normals.size() / 3;
+        texcoordTotal += chunk.texcoords.size() / 2;
+    }
+
+    attrib->vertices.resize(vertexTotal * 3);
+    attrib->normals.resize(normalTotal * 3);
+    attrib->texcoords.resize(texcoordTotal * 2);
+    attrib->vertex_weights.clear();
+    attrib->texcoord_ws.clear();
+    attrib->colors.clear();
+    attrib->skin_weights.clear();
+    runOnChunks(chunks, threadCount, [attrib](ObjChunk& chunk) {
+        std::copy(chunk.positions.begin(), chunk.positions.end(), attrib->vertices.begin() + 3 * chunk.vertexBase);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), attrib->normals.begin() + 3 * chunk.normalBase);
+        std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), attrib->texcoords.begin() + 2 * chunk.texcoordBase);
+        std::vector<tinyobj::real_t>().swap(chunk.positions);
+        std::vector<tinyobj::real_t>().swap(chunk.normals);
+        std::vector<tinyobj::real_t>().swap(chunk.texcoords);
+    });
+
+    const std::vector<tinyobj::real_t>& positions = attrib->vertices;
+    runOnChunks(chunks, threadCount, [&positions](ObjChunk& chunk) { fixupChunk(chunk, positions); });
+
+    std::string warnings, errors;
+    std::map<std::string, int> materialMap;
+    materials->clear();
+    loadMaterials(chunks, materials, materialMap, materialDir, warnings, errors);
+
+    // Walk the chunks in file order and cut shapes at g/o records.
+    shapes->clear();
+    tinyobj::shape_t shape;
+    std::string name;
+    int materialId = -1;
+    unsigned int smoothingId = 0;
+    for (ObjChunk& chunk : chunks) {
+        warnings += chunk.warning;
+        if (!chunk.error.empty()) {
+            errors += chunk.error + ".\n";
+        }
+        const std::vector<tinyobj::index_t>& triangles = chunk.cornersAreTriangles ? chunk.corners : chunk.triangles;
+        size_t cursorTriangle = 0;
+        for (size_t e = 0; e < chunk.events.size(); ++e) {
+            const ObjEvent& event = chunk.events[e];
+            appendTriangles(shape, name, triangles, cursorTriangle, chunk.eventTriangle[e], materialId, smoothingId);
+            cursorTriangle = chunk.eventTriangle[e];
+            if (event.type == EVENT_GROUP || event.type == EVENT_OBJECT) {
+                if (!shape.mesh.indices.empty()) shapes->push_back(shape);
+                shape = tinyobj::shape_t();
+                name = event.name;
+            }
+            else if (event.type == EVENT_USEMTL) {
+                std::map<std::string, int>::const_iterator it = materialMap.find(event.name);
+                if (it != materialMap.end()) {
+                    materialId = it->second;
+                }
+                else {
+                    materialId = -1;
+                    warnings += "material [ '" + event.name + "' ] not found in .mtl\n";
+                }
+            }
+            else {
+                smoothingId = event.smoothingId;
+            }
+        }
+        appendTriangles(shape, name, triangles, cursorTriangle, triangles.size() / 3, materialId, smoothingId);
+        std::vector<tinyobj::index_t>().swap(chunk.corners);
+        std::vector<tinyobj::index_t>().swap(chunk.triangles);
+    }
+    if (!shape.mesh.indices.empty()) shapes->push_back(shape);
+
+    if (warn) (*warn) += warnings;
+    if (err) (*err) += errors;
+    return errors.empty();
+}
+
+// Inflates the file a segment at a time, cut after its last newline, and
+// parses each segment on the worker threads while the next one inflates.
+// Parsed chunks keep no pointers into their text, so at most two segments
+// of text exist at once rather than the whole decompressed file.
+bool parseGzipBuffer(const unsigned char* data, size_t size, tinyobj::attrib_t* attrib,
+                     std::vector<tinyobj::shape_t>* shapes, std::vector<tinyobj::material_t>* materials,
+                     std::string* warn, std::string* err, unsigned int threadCount, const char* filename) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    const size_t segmentBytes = threadCount * GZIP_SEGMENT_BYTES_PER_THREAD;
+    InflateStream stream(data, size, InflateStream::GZIP);
+    std::vector<char> text[2];
+    std::deque<std::vector<ObjChunk>> segments;  // deque: parsing holds references
+    std::thread parser;
+    size_t carry = 0;  // unfinished last line, moved to the front of the next segment
+    for (int current = 0;; current = 1 - current) {
+        std::vector<char>& buffer = text[current];
+        const std::vector<char>& previous = text[1 - current];
+        buffer.assign(previous.end() - carry, previous.end());
+        buffer.resize(carry + segmentBytes);
+        size_t filled = carry;
+        while (filled < buffer.size()) {
+            size_t count = stream.read(reinterpret_cast<unsigned char*>(&buffer[filled]), buffer.size() - filled);
+            if (count == 0) break;
+            filled += count;
+        }
+        bool last = filled < buffer.size();
+        buffer.resize(filled);
+        size_t cut = filled;
+        if (!last) {
+            // A line longer than the segment stays whole in the carry.
+            while (cut > 0 && buffer[cut - 1] != '\n') --cut;
+        }
+        carry = filled - cut;
+
+        if (parser.joinable()) parser.join();
+        segments.emplace_back();
+        std::vector<ObjChunk>& chunks = segments.back();
+        splitChunks(buffer.data(), cut, threadCount, chunks);
+        parser = std::thread([&chunks, threadCount]() { runOnChunks(chunks, threadCount, parseChunk); });
+        if (last) break;
+    }
+    parser.join();
+    std::vector<char>().swap(text[0]);
+    std::vector<char>().swap(text[1]);
+    if (stream.error()) {
+        if (err) (*err) += std::string("Cannot decompress [") + filename + "]: " + stream.error() + "\n";
+        return false;
+    }
+
+    std::vector<ObjChunk> chunks;
+    for (std::vector<ObjChunk>& segment : segments) {
+        for (ObjChunk& chunk : segment) chunks.push_back(std::move(chunk));
+    }
+    return mergeChunks(chunks, threadCount, attrib, shapes, materials, warn, err, objMaterialDir(filename));
+}
+
+}  // namespace
+
+
+bool parseObjBuffer(const char* data, size_t size, tinyobj::attrib_t* attrib,
+                    std::vector<tinyobj::shape_t>* shapes,
+                    std::vector<tinyobj::material_t>* materials, std::string* warn,
+                    std::string* err, unsigned int threadCount, const std::string& materialDir) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<ObjChunk> chunks;
+    splitChunks(data, size, threadCount, chunks);
+    runOnChunks(chunks, threadCount, parseChunk);
+    return mergeChunks(chunks, threadCount, attrib, shapes, materials, warn, err, materialDir);
+}
+
+bool loadObjParallel(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+                     std::vector<tinyobj::material_t>* materials, std::string* warn,
+                     std::string* err, const char* filename, unsigned int threadCount,
+                     bool mapInput) {
+    // The parser only needs a read-only byte range, so a mapping avoids the
+    // read() copy and the second full-size heap buffer. Empty or unmappable
+    // files fall through to the buffered read.
+    if (mapInput) {
+        MappedFile mapped;
+        if (mapped.open(filename, true)) {
+            if (InflateStream::hasGzipMagic(mapped.data(), mapped.size())) {
+                return parseGzipBuffer(mapped.data(), mapped.size(), attrib, shapes, materials, warn, err,
+                                       threadCount, filename);
+            }
+            return parseObjBuffer(reinterpret_cast<const char*>(mapped.data()), mapped.size(), attrib, shapes,
+                                  materials, warn, err, threadCount, objMaterialDir(filename));
+        }
+    }
+
+    std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file) {
+        if (err) (*err) += std::string("Cannot open file [") + filename + "]\n";
+        return false;
+    }
+    std::streamoff length = file.tellg();
+    file.seekg(0, std::ios::beg);
+    std::vector<char> buffer(length > 0 ? size_t(length) : 0);
+    if (!buffer.empty() && !file.read(&buffer[0], std::streamsize(buffer.size()))) {
+        if (err) (*err) += std::string("Failed to read file [") + filename + "]\n";
+        return false;
+    }
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(buffer.data());
+    if (InflateStream::hasGzipMagic(bytes, buffer.size())) {
+        return parseGzipBuffer(bytes, buffer.size(), attrib, shapes, materials, warn, err, threadCount, filename);
+    }
+    return parseObjBuffer(buffer.data(), buffer.size(), attrib, shapes, materials, warn, err, threadCount,
+                          objMaterialDir(filename));
+}
+
+std::string objMaterialDir(const std::string& objPath) {
+    return objPath.substr(0, objPath.find_last_of("/\\") + 1);
+}
+
+const char* objScannerName() {
+    return useSimdScan ? objscan::instructionSetName() : "scalar";
+}
+
+void setObjScannerSimd(bool enabled) {
+    useSimdScan = enabled;
+}
@@ -0,0 +1,56 @@
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+
+// Multithreaded drop-in for tinyobj::LoadObj (triangulating, v1 API).
+//
+// The file buffer is split on newline boundaries into one chunk per thread.
+// Each thread parses its v/vn/vt/f records into thread-local arrays, a prefix
+// sum over the per-chunk counts turns relative (negative) face indices into
+// absolute ones, and the chunks are then merged into the usual attrib_t and
+// shape_t structures. Numbers are parsed with the same arithmetic as tinyobj,
+// so attribute values are bit-identical to the single-threaded loader.
+//
+// Handled records: v, vn, vt, f, g, o, s, usemtl, mtllib. Vertex colors,
+// weights, lines, points and tags are ignored. Quads are split along the
+// shorter diagonal like tinyobj; larger polygons are fanned.
+//
+// threadCount == 0 uses one thread per hardware thread. With mapInput the
+// file is memory-mapped with a sequential-access hint and tokenized in place;
+// otherwise it is read into a heap buffer first.
+//
+// Gzip-compressed files (recognized by their magic bytes, e.g. .obj.gz) are
+// inflated with InflateStream a segment (4 MiB per thread) at a time, and
+// each segment is parsed while the next one inflates, so the decompressed
+// text never has to fit in memory at once.
+
+bool loadObjParallel(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+                     std::vector<tinyobj::material_t>* materials, std::string* warn,
+                     std::string* err, const char* filename, unsigned int threadCount = 0,
+                     bool mapInput = true);
+
+// Parses OBJ text already in memory; mtllib files are looked up in
+// materialDir (see objMaterialDir).
+bool parseObjBuffer(const char* data, size_t size, tinyobj::attrib_t* attrib,
+                    std::vector<tinyobj::shape_t>* shapes,
+                    std::vector<tinyobj::material_t>* materials, std::string* warn,
+                    std::string* err, unsigned int threadCount = 0,
+                    const std::string& materialDir = std::string());
+
+// Directory part of an OBJ path, with its trailing separator ("" for a bare
+// file name): where the file's mtllib records point. tinyobj looks in the
+// working directory unless given this as its mtl_basedir.
+std::string objMaterialDir(const std::string& objPath);
+
+// Line and token scanning uses SSE2/AVX2 (see obj_scan.h) unless disabled
+// here; the scalar scanner exists for benchmarking and produces the same
+// output. Must not be called while a parse is running.
+void setObjScannerSimd(bool enabled);
+const char* objScannerName();
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef OBJ_SCAN_H
+#define OBJ_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Vectorized byte scanning for the OBJ parser. AVX2 is used when the build
+// targets it (-mavx2, /arch:AVX2 or TOON_OBJ_AVX2 in CMake), SSE2 on any
+// other x86-64 build, and a scalar loop everywhere else. All functions read
+// exactly the number of bytes they are documented to, so callers must make
+// sure that many bytes are addressable.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OBJ_SCAN_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OBJ_SCAN_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace objscan {
+
+inline unsigned int countTrailingZeros(uint64_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned int>(index);
+#else
+    return static_cast<unsigned int>(__builtin_ctzll(mask));
+#endif
+}
+
+inline const char* instructionSetName() {
+#if defined(OBJ_SCAN_AVX2)
+    return "AVX2";
+#elif defined(OBJ_SCAN_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+// Bit i is set when p[i] == '\n'. Reads 64 bytes.
+inline uint64_t newlineMask64(const char* p) {
+#if defined(OBJ_SCAN_AVX2)
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    uint64_t maskLo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline)));
+    uint64_t maskHi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)));
+    return maskLo | (maskHi << 32);
+#elif defined(OBJ_SCAN_SSE2)
+    const __m128i newline = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)))) << (16 * i);
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; ++i) {
+        mask |= static_cast<uint64_t>(p[i] == '\n') << i;
+    }
+    return mask;
+#endif
+}
+
+// Offset of the first ' ', '\t', '\r' or '\n' in p[0..16), or 16 if there is
+// none. Reads 16 bytes.
+inline unsigned int delimiterOffset16(const char* p) {
+#if defined(OBJ_SCAN_AVX2) || defined(OBJ_SCAN_SSE2)
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i hits = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+        _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))));
+    unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(hits));
+    return mask ? countTrailingZeros(mask) : 16u;
+#else
+    for (unsigned int i = 0; i < 16; ++i) {
+        char c = p[i];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') return i;
+    }
+    return 16u;
+#endif
+}
+
+}  // namespace objscan
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef OBJ_VERTICES_H
+#define OBJ_VERTICES_H
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+#include "vertex_dedup.h"
+#include "vertex_format.h"
+
+// Loads an OBJ with tinyobj's LoadObj into deduplicated vertices of any
+// PackedVertex format plus triangle indices. This is the whole loader of
+// the small front-ends (main_texture.cpp and friends); the main app uses
+// loadObjModel (mesh.h), which adds caching, parallel parsing and normal
+// generation on top of the same per-format fill code.
+//
+// Non-triangle faces are skipped with a warning. Returns false if the file
+// can't be read or yields no triangles.
+template <typename VertexType>
+bool loadObjVertices(const std::string& filepath, std::vector<VertexType>& vertices,
+                     std::vector<unsigned int>& indices) {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    // mtllib paths are relative to the OBJ, not the working directory.
+    std::string materialDir = filepath.substr(0, filepath.find_last_of("/\\") + 1);
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str(), materialDir.c_str())) {
+        if (!err.empty()) {
+            std::cerr << "TinyObjLoader Error: " << err << std::endl;
+        }
+        return false;
+    }
+    if (!warn.empty()) {
+        std::cout << "TinyObjLoader Warning: " << warn << std::endl;
+    }
+
+    size_t cornerCount = 0;
+    for (const auto& shape : shapes) cornerCount += shape.mesh.indices.size();
+    // Unique corners are bounded by the index count, and in practice by the
+    // largest attribute array, so size the table from the smaller of the two.
+    size_t attribCount = std::max({ attrib.vertices.size() / 3, attrib.normals.size() / 3, attrib.texcoords.size() / 2 });
+    VertexDedupTable uniqueVertices(std::min(cornerCount, attribCount));
+    const ObjArrays<tinyobj::real_t> arrays = { attrib.vertices, attrib.normals, attrib.texcoords };
+
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(std::min(cornerCount, attribCount));
+    indices.reserve(cornerCount);
+
+    for (const auto& shape : shapes) {
+        size_t index_offset = 0;
+        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); ++f) {
+            size_t fv = shape.mesh.num_face_vertices[f];
+            if (fv != 3) {
+                std::cerr << "Warning: TinyObjLoader found a non-triangle face (vertices=" << fv << "). Skipping." << std::endl;
+                index_offset += fv;
+                continue;
+            }
+            for (size_t v = 0; v < fv; ++v) {
+                const tinyobj::index_t& idx = shape.mesh.indices[index_offset + v];
+                tinyobj::index_t key = VertexType::dedupKey(idx);
+                bool inserted;
+                unsigned int vertexIndex = uniqueVertices.findOrInsert(
+                    key.vertex_index, key.normal_index, key.texcoord_index,
+                    static_cast<unsigned int>(vertices.size()), inserted);
+                if (inserted) {
+                    vertices.push_back(VertexType::fromObj(arrays, idx));
+                }
+                indices.push_back(vertexIndex);
+            }
+            index_offset += fv;
+        }
+    }
+
+    if (vertices.empty() || indices.empty()) {
+        std::cerr << "Warning: Loaded OBJ file resulted in empty mesh data." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// For front-ends without normal generation: corners the OBJ gave no normal
+// (left at zero by NormalAttribute) get fallback instead.
+template <typename VertexType>
+size_t replaceMissingNormals(std::vector<VertexType>& vertices, const glm::vec3& fallback) {
+    size_t replaced = 0;
+    for (VertexType& vertex : vertices) {
+        if (vertex.Normal == glm::vec3(0.0f)) {
+            vertex.Normal = fallback;
+            ++replaced;
+        }
+    }
+    return replaced;
+}
+
+// For front-ends that light with the file's normals as given: scales them to
+// unit length, since OBJ exporters don't all write unit normals. Zero
+// normals (see replaceMissingNormals) are left alone.
+template <typename VertexType>
+void normalizeNormals(std::vector<VertexType>& vertices) {
+    for (VertexType& vertex : vertices) {
+        if (vertex.Normal != glm::vec3(0.0f)) vertex.Normal = glm::normalize(vertex.Normal);
+    }
+}
+
+#endif
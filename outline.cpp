@@ -0,0 +1,247 @@
+#include "outline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "vertex_quantize.h"
+
+namespace {
+
+// Edge groups without meshlets: this many consecutive triangles, which the
+// vertex cache order keeps close together.
+const size_t CLUSTER_TRIANGLES = 64;
+
+// As for meshlets: a wider cone (cosine of the widest normal to the axis)
+// can't tell anything worth the test.
+const float MIN_CONE_SPREAD = 0.1f;
+
+// One side of a triangle edge; low and high are the position ids of its ends.
+struct HalfEdge {
+    unsigned int low, high;
+    unsigned int triangle;
+    unsigned int from, to;
+};
+
+struct EdgeRecord {
+    unsigned int group;  // 2 * cluster, plus 1 unless it is a crease
+    MeshEdge edge;
+};
+
+void packNormal(const glm::vec3& normal, int16_t packed[2]) {
+    glm::vec2 encoded = encodeOctahedral(normal);
+    packed[0] = static_cast<int16_t>(std::lround(encoded.x * 32767.0f));
+    packed[1] = static_cast<int16_t>(std::lround(encoded.y * 32767.0f));
+}
+
+glm::vec3 unpackNormal(const int16_t packed[2]) {
+    return decodeOctahedral(glm::vec2(packed[0], packed[1]) / 32767.0f);
+}
+
+// Numbers the distinct positions; ids[v] is shared by every vertex at v's.
+// Returns the number of positions.
+size_t positionIds(const Vertex* vertices, size_t vertexCount, std::vector<unsigned int>& ids) {
+    std::vector<unsigned int> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0u);
+    auto less = [vertices](unsigned int a, unsigned int b) {
+        const glm::vec3& p = vertices[a].Position;
+        const glm::vec3& q = vertices[b].Position;
+        return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+    };
+    std::sort(order.begin(), order.end(), less);
+    ids.resize(vertexCount);
+    unsigned int id = 0;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        if (i > 0 && less(order[i - 1], order[i])) ++id;
+        ids[order[i]] = id;
+    }
+    return vertexCount > 0 ? id + 1 : 0;
+}
+
+// Bounds and cone from the stored (quantized) normals, so the cone agrees
+// with the per-edge tests in extractOutlines.
+void computeBounds(EdgeCluster& cluster, const MeshEdge* edges, const Vertex* vertices) {
+    glm::vec3 lo = vertices[edges[0].vertices[0]].Position, hi = lo;
+    for (unsigned int i = 0; i < cluster.edgeCount; ++i) {
+        for (unsigned int v : edges[i].vertices) {
+            lo = glm::min(lo, vertices[v].Position);
+            hi = glm::max(hi, vertices[v].Position);
+        }
+    }
+    cluster.center = 0.5f * (lo + hi);
+    float radiusSquared = 0.0f;
+    for (unsigned int i = 0; i < cluster.edgeCount; ++i) {
+        for (unsigned int v : edges[i].vertices) {
+            glm::vec3 d = vertices[v].Position - cluster.center;
+            radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+        }
+    }
+    cluster.radius = std::sqrt(radiusSquared);
+
+    std::vector<glm::vec3> normals(2 * cluster.edgeCount);
+    glm::vec3 normalSum(0.0f);
+    for (unsigned int i = 0; i < cluster.edgeCount; ++i) {
+        normals[2 * i] = unpackNormal(edges[i].normals[0]);
+        normals[2 * i + 1] = unpackNormal(edges[i].normals[1]);
+        normalSum += normals[2 * i] + normals[2 * i + 1];
+    }
+    float length = glm::length(normalSum);
+    if (length <= 0.0f) return;
+    glm::vec3 axis = normalSum / length;
+    float spread = 1.0f;
+    for (const glm::vec3& normal : normals) spread = std::min(spread, glm::dot(normal, axis));
+    if (spread <= MIN_CONE_SPREAD) return;
+    cluster.coneAxis = axis;
+    cluster.coneCutoff = std::sqrt(1.0f - spread * spread);
+}
+
+}  // namespace
+
+
+size_t buildOutlineEdges(MeshData& meshData, float creaseAngle) {
+    meshData.edges.clear();
+    meshData.edgeClusters.clear();
+    const Vertex* vertices = meshData.vertexData();
+    const unsigned int* indices = meshData.indexData();
+    size_t triangleCount = meshData.baseIndexCount() / 3;
+    if (triangleCount == 0) return 0;
+
+    std::vector<unsigned int> ids;
+    size_t positionCount = positionIds(vertices, meshData.vertexCount(), ids);
+    std::vector<glm::vec3> normals(triangleCount);
+    std::vector<HalfEdge> halfEdges;
+    halfEdges.reserve(3 * triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const unsigned int* corner = indices + 3 * t;
+        glm::vec3 cross = glm::cross(vertices[corner[1]].Position - vertices[corner[0]].Position,
+                                     vertices[corner[2]].Position - vertices[corner[0]].Position);
+        float length = glm::length(cross);
+        // Degenerate faces (or ones too large to measure in float) have no
+        // facing and don't bound the surface.
+        if (!(length > 0.0f) || std::isinf(length)) continue;
+        normals[t] = cross / length;
+        for (int k = 0; k < 3; ++k) {
+            HalfEdge halfEdge;
+            halfEdge.from = corner[k];
+            halfEdge.to = corner[(k + 1) % 3];
+            halfEdge.low = std::min(ids[halfEdge.from], ids[halfEdge.to]);
+            halfEdge.high = std::max(ids[halfEdge.from], ids[halfEdge.to]);
+            halfEdge.triangle = static_cast<unsigned int>(t);
+            if (halfEdge.low != halfEdge.high) halfEdges.push_back(halfEdge);
+        }
+    }
+
+    // Counting sort by the lower end, then each short run by the other end,
+    // brings the sides of every edge together.
+    std::vector<unsigned int> runStart(positionCount + 1, 0);
+    for (const HalfEdge& halfEdge : halfEdges) ++runStart[halfEdge.low + 1];
+    for (size_t p = 0; p < positionCount; ++p) runStart[p + 1] += runStart[p];
+    std::vector<HalfEdge> sorted(halfEdges.size());
+    {
+        std::vector<unsigned int> cursor(runStart.begin(), runStart.end() - 1);
+        for (const HalfEdge& halfEdge : halfEdges) sorted[cursor[halfEdge.low]++] = halfEdge;
+    }
+    std::vector<HalfEdge>().swap(halfEdges);
+    for (size_t p = 0; p < positionCount; ++p) {
+        std::sort(sorted.begin() + runStart[p], sorted.begin() + runStart[p + 1], [](const HalfEdge& a, const HalfEdge& b) {
+            return a.high != b.high ? a.high < b.high : a.triangle < b.triangle;
+        });
+    }
+
+    // An edge goes with the first of its faces in index order, i.e. with
+    // that face's meshlet or run of triangles.
+    std::vector<unsigned int> triangleCluster(triangleCount);
+    size_t clusterCount = 0;
+    if (meshData.meshlets.empty()) {
+        for (size_t t = 0; t < triangleCount; ++t) triangleCluster[t] = static_cast<unsigned int>(t / CLUSTER_TRIANGLES);
+        clusterCount = (triangleCount + CLUSTER_TRIANGLES - 1) / CLUSTER_TRIANGLES;
+    }
+    else {
+        for (const Meshlet& meshlet : meshData.meshlets) {
+            std::fill(triangleCluster.begin() + meshlet.indexOffset / 3,
+                      triangleCluster.begin() + (meshlet.indexOffset + meshlet.indexCount) / 3,
+                      static_cast<unsigned int>(clusterCount));
+            ++clusterCount;
+        }
+    }
+    float creaseCosine = std::cos(glm::radians(creaseAngle));
+
+    std::vector<EdgeRecord> records;
+    records.reserve(sorted.size() / 2 + 1);
+    for (size_t i = 0; i < sorted.size();) {
+        size_t end = i + 1;
+        while (end < sorted.size() && sorted[end].low == sorted[i].low && sorted[end].high == sorted[i].high) ++end;
+        // Two faces make an ordinary edge. Any other count (open or
+        // non-manifold) gives each face an open edge of its own.
+        bool shared = end - i == 2;
+        for (size_t j = i; j < end; j += shared ? 2 : 1) {
+            const HalfEdge& halfEdge = sorted[j];
+            glm::vec3 normal = normals[halfEdge.triangle];
+            glm::vec3 otherNormal = shared ? normals[sorted[j + 1].triangle] : -normal;
+            bool crease = shared && glm::dot(normal, otherNormal) < creaseCosine;
+            EdgeRecord record;
+            record.group = 2 * triangleCluster[halfEdge.triangle] + (crease ? 0 : 1);
+            record.edge.vertices[0] = halfEdge.from;
+            record.edge.vertices[1] = halfEdge.to;
+            packNormal(normal, record.edge.normals[0]);
+            packNormal(otherNormal, record.edge.normals[1]);
+            records.push_back(record);
+        }
+        i = end;
+    }
+
+    // Counting sort by cluster, creases first; the order inside stays the
+    // position order from above.
+    std::vector<unsigned int> groupStart(2 * clusterCount + 1, 0);
+    for (const EdgeRecord& record : records) ++groupStart[record.group + 1];
+    for (size_t g = 0; g < 2 * clusterCount; ++g) groupStart[g + 1] += groupStart[g];
+    meshData.edges.resize(records.size());
+    {
+        std::vector<unsigned int> cursor(groupStart.begin(), groupStart.end() - 1);
+        for (const EdgeRecord& record : records) meshData.edges[cursor[record.group]++] = record.edge;
+    }
+    for (size_t c = 0; c < clusterCount; ++c) {
+        EdgeCluster cluster;
+        cluster.edgeOffset = groupStart[2 * c];
+        cluster.edgeCount = groupStart[2 * c + 2] - groupStart[2 * c];
+        cluster.creaseCount = groupStart[2 * c + 1] - groupStart[2 * c];
+        if (cluster.edgeCount == 0) continue;
+        computeBounds(cluster, &meshData.edges[cluster.edgeOffset], vertices);
+        meshData.edgeClusters.push_back(cluster);
+    }
+    return meshData.edges.size();
+}
+
+size_t extractOutlines(const MeshData& meshData, const MeshletCuller& culler, std::vector<unsigned int>& lines) {
+    const Vertex* vertices = meshData.vertexData();
+    const glm::vec3& viewPosition = culler.viewPosition();
+    size_t before = lines.size();
+    for (const EdgeCluster& cluster : meshData.edgeClusters) {
+        if (!culler.isInFrustum(cluster.center, cluster.radius) ||
+            culler.facesAway(cluster.center, cluster.radius, cluster.coneAxis, cluster.coneCutoff)) {
+            continue;
+        }
+        const MeshEdge* edges = meshData.edges.data() + cluster.edgeOffset;
+        if (culler.facesAway(cluster.center, cluster.radius, -cluster.coneAxis, cluster.coneCutoff)) {
+            // Every face looks at the viewer: no silhouette, every crease.
+            for (unsigned int i = 0; i < cluster.creaseCount; ++i) {
+                lines.push_back(edges[i].vertices[0]);
+                lines.push_back(edges[i].vertices[1]);
+            }
+            continue;
+        }
+        for (unsigned int i = 0; i < cluster.edgeCount; ++i) {
+            // Both faces contain the edge, so one of its ends serves for both.
+            glm::vec3 toViewer = viewPosition - vertices[edges[i].vertices[0]].Position;
+            bool front = glm::dot(unpackNormal(edges[i].normals[0]), toViewer) > 0.0f;
+            bool otherFront = glm::dot(unpackNormal(edges[i].normals[1]), toViewer) > 0.0f;
+            if (front != otherFront || (i < cluster.creaseCount && front)) {
+                lines.push_back(edges[i].vertices[0]);
+                lines.push_back(edges[i].vertices[1]);
+            }
+        }
+    }
+    return (lines.size() - before) / 2;
+}
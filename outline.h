@@ -0,0 +1,30 @@
+#ifndef OUTLINE_H
+#define OUTLINE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "mesh.h"
+#include "meshlet.h"
+
+// Fills meshData.edges and meshData.edgeClusters from the full-resolution
+// triangles. Vertices at the same position are joined first, so normal and
+// material seams don't open the surface up. Each edge keeps the normals of
+// the two faces that meet there; where they differ by more than creaseAngle
+// degrees the edge is a crease. Edges are grouped by the meshlet of their
+// first face (runs of 64 triangles without meshlets), and every group gets
+// a bounding sphere and a cone around its face normals. Run it after the
+// last pass that reorders triangles or renumbers vertices. Returns the
+// number of edges.
+size_t buildOutlineEdges(MeshData& meshData, float creaseAngle);
+
+// Appends GL_LINES vertex pairs for the edges to outline as seen from
+// culler.viewPosition(): silhouettes, where a face towards it meets one
+// facing away, and creases beside a face towards it. Groups outside the
+// frustum are skipped, so are groups whose cone faces away entirely, and
+// groups that face the viewer entirely only contribute their creases; edges
+// are tested one by one only near the silhouette. Returns the number of
+// edges appended.
+size_t extractOutlines(const MeshData& meshData, const MeshletCuller& culler, std::vector<unsigned int>& lines);
+
+#endif
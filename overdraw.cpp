@@ -0,0 +1,237 @@
+#include "overdraw.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+
+const int OVERDRAW_RESOLUTION = 256;
+
+struct Fragments {
+    size_t shaded = 0;
+    size_t covered = 0;
+};
+
+// Counts depth-passing fragments for one axis-aligned orthographic view.
+// Pixel centres exactly on an edge shared by two triangles belong to one of
+// them only, so seams aren't counted as overdraw.
+class OverdrawRaster {
+public:
+    OverdrawRaster() : depth(OVERDRAW_RESOLUTION * OVERDRAW_RESOLUTION) {}
+
+    Fragments draw(const std::vector<glm::vec3>& projected, const unsigned int* indices, size_t indexCount) {
+        std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::infinity());
+        Fragments fragments;
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            glm::vec3 a = projected[indices[i]], b = projected[indices[i + 1]], c = projected[indices[i + 2]];
+            float area = edge(a, b, c);
+            if (area == 0.0f) continue;
+            if (area < 0.0f) {
+                std::swap(b, c);
+                area = -area;
+            }
+            int x0 = std::max(0, int(std::floor(std::min(a.x, std::min(b.x, c.x)))));
+            int y0 = std::max(0, int(std::floor(std::min(a.y, std::min(b.y, c.y)))));
+            int x1 = std::min(OVERDRAW_RESOLUTION - 1, int(std::ceil(std::max(a.x, std::max(b.x, c.x)))));
+            int y1 = std::min(OVERDRAW_RESOLUTION - 1, int(std::ceil(std::max(a.y, std::max(b.y, c.y)))));
+            for (int y = y0; y <= y1; ++y) {
+                for (int x = x0; x <= x1; ++x) {
+                    glm::vec3 p(x + 0.5f, y + 0.5f, 0.0f);
+                    float wa = edge(b, c, p), wb = edge(c, a, p), wc = edge(a, b, p);
+                    if (!inside(wa, b, c) || !inside(wb, c, a) || !inside(wc, a, b)) continue;
+                    float z = (wa * a.z + wb * b.z + wc * c.z) / area;
+                    float& stored = depth[y * OVERDRAW_RESOLUTION + x];
+                    if (z < stored) {
+                        if (stored == std::numeric_limits<float>::infinity()) ++fragments.covered;
+                        stored = z;
+                        ++fragments.shaded;
+                    }
+                }
+            }
+        }
+        return fragments;
+    }
+
+private:
+    static float edge(const glm::vec3& from, const glm::vec3& to, const glm::vec3& p) {
+        return (to.x - from.x) * (p.y - from.y) - (to.y - from.y) * (p.x - from.x);
+    }
+
+    // Ties go to the triangle that sees the shared edge in one particular
+    // direction; its neighbour sees it reversed.
+    static bool inside(float w, const glm::vec3& from, const glm::vec3& to) {
+        if (w != 0.0f) return w > 0.0f;
+        float dx = to.x - from.x, dy = to.y - from.y;
+        return dy > 0.0f || (dy == 0.0f && dx < 0.0f);
+    }
+
+    std::vector<float> depth;
+};
+
+// FIFO cache simulation over whole triangles; flush() empties the cache
+// without touching the per-vertex array.
+class CacheSimulation {
+public:
+    CacheSimulation(size_t vertexCount, unsigned int cacheSize)
+        : timestamp(vertexCount, 0), cacheSize(cacheSize), stamp(cacheSize + 1) {}
+
+    unsigned int misses(const unsigned int* triangle) {
+        unsigned int count = 0;
+        for (int k = 0; k < 3; ++k) {
+            unsigned int& entered = timestamp[triangle[k]];
+            if (stamp - entered > cacheSize) {
+                entered = stamp++;
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    void flush() { stamp += cacheSize + 1; }
+
+private:
+    std::vector<unsigned int> timestamp;
+    unsigned int cacheSize;
+    unsigned int stamp;
+};
+
+// Splits a Tipsify-ordered range into clusters: at cache restarts (all three
+// vertices miss), then wherever the running ACMR of the current cluster,
+// starting from a cold cache, is within threshold of the whole hard
+// cluster's. Returns the first triangle of each cluster.
+std::vector<size_t> clusterStarts(const unsigned int* indices, size_t triangleCount, float threshold,
+                                  CacheSimulation& cache) {
+    std::vector<size_t> hard;
+    cache.flush();
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (cache.misses(indices + 3 * t) == 3 || t == 0) hard.push_back(t);
+    }
+    hard.push_back(triangleCount);
+
+    std::vector<size_t> starts;
+    for (size_t h = 0; h + 1 < hard.size(); ++h) {
+        size_t begin = hard[h], end = hard[h + 1];
+        cache.flush();
+        size_t clusterMisses = 0;
+        for (size_t t = begin; t < end; ++t) clusterMisses += cache.misses(indices + 3 * t);
+        double budget = threshold * double(clusterMisses) / double(end - begin);
+
+        cache.flush();
+        starts.push_back(begin);
+        size_t runningMisses = 0, runningTriangles = 0;
+        for (size_t t = begin; t + 1 < end; ++t) {
+            runningMisses += cache.misses(indices + 3 * t);
+            ++runningTriangles;
+            if (double(runningMisses) <= budget * double(runningTriangles)) {
+                starts.push_back(t + 1);
+                cache.flush();
+                runningMisses = runningTriangles = 0;
+            }
+        }
+    }
+    return starts;
+}
+
+size_t optimizeRange(unsigned int* indices, size_t triangleCount, const Vertex* vertices, float threshold,
+                     CacheSimulation& cache) {
+    if (triangleCount < 2) return triangleCount;
+    std::vector<size_t> starts = clusterStarts(indices, triangleCount, threshold, cache);
+    size_t clusterCount = starts.size();
+    starts.push_back(triangleCount);
+
+    // Area-weighted centroid and normal of each cluster and of the range.
+    std::vector<glm::vec3> centroids(clusterCount), normals(clusterCount);
+    glm::vec3 rangeCentroid(0.0f);
+    float rangeArea = 0.0f;
+    for (size_t k = 0; k < clusterCount; ++k) {
+        glm::vec3 centroid(0.0f), normal(0.0f), plain(0.0f);
+        float area = 0.0f;
+        for (size_t t = starts[k]; t < starts[k + 1]; ++t) {
+            const glm::vec3& a = vertices[indices[3 * t]].Position;
+            const glm::vec3& b = vertices[indices[3 * t + 1]].Position;
+            const glm::vec3& c = vertices[indices[3 * t + 2]].Position;
+            glm::vec3 cross = glm::cross(b - a, c - a);
+            float weight = glm::length(cross);
+            centroid += (a + b + c) * (weight / 3.0f);
+            plain += (a + b + c) / 3.0f;
+            normal += cross;
+            area += weight;
+        }
+        centroids[k] = area > 0.0f ? centroid / area : plain / float(starts[k + 1] - starts[k]);
+        normals[k] = normal;
+        rangeCentroid += centroids[k] * area;
+        rangeArea += area;
+    }
+    if (rangeArea > 0.0f) rangeCentroid /= rangeArea;
+
+    // Occlusion potential: clusters facing away from the centre and far out
+    // along their normal cover the most of the rest from any direction.
+    std::vector<float> potential(clusterCount, 0.0f);
+    for (size_t k = 0; k < clusterCount; ++k) {
+        float length = glm::length(normals[k]);
+        if (length > 0.0f) potential[k] = glm::dot(centroids[k] - rangeCentroid, normals[k] / length);
+    }
+    std::vector<size_t> order(clusterCount);
+    for (size_t k = 0; k < clusterCount; ++k) order[k] = k;
+    std::stable_sort(order.begin(), order.end(),
+                     [&potential](size_t a, size_t b) { return potential[a] > potential[b]; });
+
+    std::vector<unsigned int> reordered;
+    reordered.reserve(3 * triangleCount);
+    for (size_t k : order) {
+        reordered.insert(reordered.end(), indices + 3 * starts[k], indices + 3 * starts[k + 1]);
+    }
+    std::copy(reordered.begin(), reordered.end(), indices);
+    return clusterCount;
+}
+
+}  // namespace
+
+
+double analyzeOverdraw(const MeshData& meshData) {
+    const Vertex* vertices = meshData.vertexData();
+    size_t vertexCount = meshData.vertexCount();
+    if (vertexCount == 0 || meshData.baseIndexCount() < 3) return 0.0;
+
+    glm::vec3 lo = vertices[0].Position, hi = lo;
+    for (size_t v = 1; v < vertexCount; ++v) {
+        lo = glm::min(lo, vertices[v].Position);
+        hi = glm::max(hi, vertices[v].Position);
+    }
+    glm::vec3 extent = hi - lo;
+    float size = std::max(extent.x, std::max(extent.y, extent.z));
+    float scale = size > 0.0f ? (OVERDRAW_RESOLUTION - 1) / size : 1.0f;
+
+    OverdrawRaster raster;
+    std::vector<glm::vec3> projected(vertexCount);
+    Fragments total;
+    for (int axis = 0; axis < 3; ++axis) {
+        int u = (axis + 1) % 3, w = (axis + 2) % 3;
+        for (float direction : { 1.0f, -1.0f }) {
+            for (size_t v = 0; v < vertexCount; ++v) {
+                glm::vec3 p = (vertices[v].Position - lo) * scale;
+                projected[v] = glm::vec3(p[u], p[w], direction * p[axis]);
+            }
+            Fragments view = raster.draw(projected, meshData.indexData(), meshData.baseIndexCount());
+            total.shaded += view.shaded;
+            total.covered += view.covered;
+        }
+    }
+    return total.covered > 0 ? double(total.shaded) / double(total.covered) : 0.0;
+}
+
+size_t optimizeOverdraw(MeshData& meshData, float threshold, unsigned int cacheSize) {
+    CacheSimulation cache(meshData.vertexCount(), cacheSize);
+    const Vertex* vertices = meshData.vertexData();
+    if (meshData.submeshes.empty()) {
+        return optimizeRange(meshData.indices.data(), meshData.baseIndexCount() / 3, vertices, threshold, cache);
+    }
+    size_t clusters = 0;
+    for (const Submesh& submesh : meshData.submeshes) {
+        clusters += optimizeRange(meshData.indices.data() + submesh.indexOffset, submesh.indexCount / 3, vertices,
+                                  threshold, cache);
+    }
+    return clusters;
+}
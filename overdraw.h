@@ -0,0 +1,25 @@
+#ifndef OVERDRAW_H
+#define OVERDRAW_H
+
+#include "mesh.h"
+
+// Fragments that pass the depth test per covered pixel when the mesh is
+// drawn in index order, averaged over orthographic views along +-X, +-Y and
+// +-Z, without face culling (the viewer's default; see main.cpp). 1.0 means
+// every pixel is shaded once; fragment-heavy styles pay for everything
+// above it.
+double analyzeOverdraw(const MeshData& meshData);
+
+// Reorders triangle clusters inside each submesh so that outward-facing
+// clusters far from the centre are drawn first, which occludes the rest
+// from most directions (the view-independent pass of Sander, Nehab &
+// Barczak 2007). Expects the Tipsify order from optimizeVertexCache: it is
+// split where the cache restarts and further where a prefix is already
+// within threshold times the cluster's ACMR, so e.g. 1.05 lets ACMR grow by
+// about 5% in exchange for more, smaller clusters.
+//
+// meshData.indices must hold the indices (not a mapping). Returns the
+// number of clusters.
+size_t optimizeOverdraw(MeshData& meshData, float threshold = 1.05f, unsigned int cacheSize = 16);
+
+#endif
@@ -0,0 +1,456 @@
+#include "ply_loader.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "normal_gen.h"
+
+namespace {
+
+enum PlyType { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_INVALID };
+
+PlyType parseType(const std::string& name) {
+    if (name == "char" || name == "int8") return PLY_INT8;
+    if (name == "uchar" || name == "uint8") return PLY_UINT8;
+    if (name == "short" || name == "int16") return PLY_INT16;
+    if (name == "ushort" || name == "uint16") return PLY_UINT16;
+    if (name == "int" || name == "int32") return PLY_INT32;
+    if (name == "uint" || name == "uint32") return PLY_UINT32;
+    if (name == "float" || name == "float32") return PLY_FLOAT32;
+    if (name == "double" || name == "float64") return PLY_FLOAT64;
+    return PLY_INVALID;
+}
+
+size_t typeSize(PlyType type) {
+    static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+    return sizes[type];
+}
+
+struct PlyProperty {
+    std::string name;
+    PlyType type = PLY_INVALID;
+    bool isList = false;
+    PlyType countType = PLY_INVALID;
+    size_t offset = 0;  // within the record; only meaningful for fixed-size elements
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> properties;
+    size_t stride = 0;  // record size if no property is a list
+    bool fixedSize = true;
+
+    int find(const char* property) const {
+        for (size_t i = 0; i < properties.size(); ++i) {
+            if (properties[i].name == property) return static_cast<int>(i);
+        }
+        return -1;
+    }
+};
+
+struct PlyHeader {
+    bool bigEndian = false;
+    size_t dataOffset = 0;
+    std::vector<PlyElement> elements;
+};
+
+bool parseHeader(const unsigned char* data, size_t size, PlyHeader& header, std::string& error) {
+    const char* text = reinterpret_cast<const char*>(data);
+    size_t pos = 0;
+    bool sawFormat = false;
+    for (int lineNumber = 0;; ++lineNumber) {
+        const char* newline = static_cast<const char*>(std::memchr(text + pos, '\n', size - pos));
+        if (!newline) {
+            error = "unterminated header";
+            return false;
+        }
+        std::string line(text + pos, newline);
+        pos = size_t(newline - text) + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        std::istringstream tokens(line);
+        std::string keyword;
+        tokens >> keyword;
+        if (lineNumber == 0) {
+            if (keyword != "ply") {
+                error = "not a PLY file";
+                return false;
+            }
+            continue;
+        }
+        if (keyword == "format") {
+            std::string format;
+            tokens >> format;
+            if (format == "binary_little_endian") header.bigEndian = false;
+            else if (format == "binary_big_endian") header.bigEndian = true;
+            else {
+                error = "unsupported format '" + format + "' (only binary PLY is supported)";
+                return false;
+            }
+            sawFormat = true;
+        }
+        else if (keyword == "element") {
+            PlyElement element;
+            tokens >> element.name >> element.count;
+            if (!tokens) {
+                error = "malformed element line";
+                return false;
+            }
+            header.elements.push_back(element);
+        }
+        else if (keyword == "property") {
+            if (header.elements.empty()) {
+                error = "property before any element";
+                return false;
+            }
+            PlyElement& element = header.elements.back();
+            PlyProperty property;
+            std::string type;
+            tokens >> type;
+            if (type == "list") {
+                std::string countType, itemType;
+                tokens >> countType >> itemType;
+                property.isList = true;
+                property.countType = parseType(countType);
+                property.type = parseType(itemType);
+                element.fixedSize = false;
+            }
+            else {
+                property.type = parseType(type);
+                property.offset = element.stride;
+                element.stride += typeSize(property.type);
+            }
+            tokens >> property.name;
+            if (!tokens || property.type == PLY_INVALID || (property.isList && property.countType == PLY_INVALID)) {
+                error = "malformed property line '" + line + "'";
+                return false;
+            }
+            element.properties.push_back(property);
+        }
+        else if (keyword == "end_header") {
+            break;
+        }
+        // comment, obj_info and unknown keywords are ignored.
+    }
+    if (!sawFormat) {
+        error = "missing format line";
+        return false;
+    }
+    header.dataOffset = pos;
+    return true;
+}
+
+template <typename T>
+T loadValue(const unsigned char* p, bool swap) {
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, p, sizeof(T));
+    if (swap) std::reverse(bytes, bytes + sizeof(T));
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+double readScalar(const unsigned char* p, PlyType type, bool swap) {
+    switch (type) {
+    case PLY_INT8: return static_cast<int8_t>(*p);
+    case PLY_UINT8: return *p;
+    case PLY_INT16: return loadValue<int16_t>(p, swap);
+    case PLY_UINT16: return loadValue<uint16_t>(p, swap);
+    case PLY_INT32: return loadValue<int32_t>(p, swap);
+    case PLY_UINT32: return loadValue<uint32_t>(p, swap);
+    case PLY_FLOAT32: return loadValue<float>(p, swap);
+    case PLY_FLOAT64: return loadValue<double>(p, swap);
+    default: return 0.0;
+    }
+}
+
+// Same as readScalar but exact for 32-bit indices; negative values come
+// back huge so the range check rejects them.
+uint64_t readIndex(const unsigned char* p, PlyType type, bool swap) {
+    switch (type) {
+    case PLY_INT8: return static_cast<uint64_t>(static_cast<int64_t>(static_cast<int8_t>(*p)));
+    case PLY_UINT8: return *p;
+    case PLY_INT16: return static_cast<uint64_t>(static_cast<int64_t>(loadValue<int16_t>(p, swap)));
+    case PLY_UINT16: return loadValue<uint16_t>(p, swap);
+    case PLY_INT32: return static_cast<uint64_t>(static_cast<int64_t>(loadValue<int32_t>(p, swap)));
+    case PLY_UINT32: return loadValue<uint32_t>(p, swap);
+    default: return UINT64_MAX;
+    }
+}
+
+// Walks one record of a variable-size element; returns its end or nullptr
+// if it runs past the data.
+const unsigned char* skipRecord(const PlyElement& element, const unsigned char* p, const unsigned char* end, bool swap) {
+    for (const PlyProperty& property : element.properties) {
+        if (!property.isList) {
+            if (size_t(end - p) < typeSize(property.type)) return nullptr;
+            p += typeSize(property.type);
+            continue;
+        }
+        size_t countSize = typeSize(property.countType);
+        if (size_t(end - p) < countSize) return nullptr;
+        uint64_t count = readIndex(p, property.countType, swap);
+        p += countSize;
+        if (count > size_t(end - p) / typeSize(property.type)) return nullptr;
+        p += size_t(count) * typeSize(property.type);
+    }
+    return p;
+}
+
+// Finds where x/y/z (or nx/ny/nz) live in a vertex record. "packed" means
+// three consecutive native-endian floats that can be copied as a vec3.
+struct Vec3Layout {
+    int property[3];
+    bool present;
+    bool packed;
+};
+
+Vec3Layout findVec3(const PlyElement& vertex, const char* x, const char* y, const char* z, bool swap) {
+    Vec3Layout layout = { { vertex.find(x), vertex.find(y), vertex.find(z) }, false, false };
+    layout.present = layout.property[0] >= 0 && layout.property[1] >= 0 && layout.property[2] >= 0;
+    if (!layout.present) return layout;
+    for (int k = 0; k < 3; ++k) {
+        if (vertex.properties[size_t(layout.property[k])].isList) layout.present = false;
+    }
+    if (!layout.present) return layout;
+    const PlyProperty& first = vertex.properties[size_t(layout.property[0])];
+    layout.packed = !swap;
+    for (int k = 0; k < 3; ++k) {
+        const PlyProperty& property = vertex.properties[size_t(layout.property[k])];
+        if (property.type != PLY_FLOAT32 || property.offset != first.offset + 4 * size_t(k)) layout.packed = false;
+    }
+    return layout;
+}
+
+glm::vec3 readVec3(const PlyElement& vertex, const Vec3Layout& layout, const unsigned char* record, bool swap) {
+    glm::vec3 value;
+    if (layout.packed) {
+        std::memcpy(&value[0], record + vertex.properties[size_t(layout.property[0])].offset, 3 * sizeof(float));
+        return value;
+    }
+    for (int k = 0; k < 3; ++k) {
+        const PlyProperty& property = vertex.properties[size_t(layout.property[k])];
+        value[k] = static_cast<float>(readScalar(record + property.offset, property.type, swap));
+    }
+    return value;
+}
+
+// Copies the vertex records into meshData.vertices, split across threads.
+// The common scanner layout (x y z nx ny nz as floats, nothing else) is a
+// straight memcpy of each range.
+void gatherVertices(const PlyElement& vertex, const unsigned char* records, bool swap, unsigned int threads,
+                    std::vector<Vertex>& vertices) {
+    Vec3Layout position = findVec3(vertex, "x", "y", "z", swap);
+    Vec3Layout normal = findVec3(vertex, "nx", "ny", "nz", swap);
+    bool identical = position.packed && normal.packed && vertex.stride == sizeof(Vertex) &&
+                     vertex.properties[size_t(position.property[0])].offset == Vertex::offsetOf<PositionAttribute>() &&
+                     vertex.properties[size_t(normal.property[0])].offset == Vertex::offsetOf<NormalAttribute>();
+
+    auto work = [&](size_t begin, size_t end) {
+        if (identical) {
+            std::memcpy(&vertices[begin], records + begin * sizeof(Vertex), (end - begin) * sizeof(Vertex));
+            return;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            const unsigned char* record = records + i * vertex.stride;
+            vertices[i].Position = readVec3(vertex, position, record, swap);
+            vertices[i].Normal = normal.present ? readVec3(vertex, normal, record, swap) : glm::vec3(0.0f);
+        }
+    };
+
+    size_t count = vertices.size();
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t minPerThread = 1 << 16;
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, (count + minPerThread - 1) / minPerThread));
+    if (threads <= 1) {
+        work(0, count);
+        return;
+    }
+    std::vector<std::thread> workers;
+    size_t step = (count + threads - 1) / threads;
+    for (unsigned int i = 1; i < threads; ++i) {
+        workers.emplace_back(work, std::min(count, i * step), std::min(count, (i + 1) * step));
+    }
+    work(0, std::min(count, step));
+    for (std::thread& worker : workers) worker.join();
+}
+
+// Appends the faces' corner lists to indices as triangle fans and advances
+// p past the element.
+bool readFaces(const PlyElement& face, const unsigned char*& p, const unsigned char* end, bool swap,
+               size_t vertexCount, std::vector<unsigned int>& indices, std::string& error) {
+    int listProperty = face.find("vertex_indices");
+    if (listProperty < 0) listProperty = face.find("vertex_index");
+    if (listProperty < 0 || !face.properties[size_t(listProperty)].isList) {
+        error = "face element has no vertex_indices list";
+        return false;
+    }
+    indices.reserve(face.count * 3);
+
+    const PlyProperty& list = face.properties[size_t(listProperty)];
+    if (face.properties.size() == 1 && list.countType == PLY_UINT8 && typeSize(list.type) == 4 && !swap &&
+        vertexCount <= 0x7FFFFFFF) {
+        // What scanners write: "property list uchar int vertex_indices" and
+        // nothing else. Comparing as uint32 also rejects negative indices.
+        const uint32_t limit = static_cast<uint32_t>(vertexCount);
+        for (size_t f = 0; f < face.count; ++f) {
+            size_t corners = p < end ? *p : size_t(-1);
+            if (p == end || corners > size_t(end - p - 1) / 4) {
+                error = "face data is truncated";
+                return false;
+            }
+            ++p;
+            uint32_t corner[3];
+            if (corners == 3) {
+                std::memcpy(corner, p, sizeof(corner));
+                if ((corner[0] >= limit) | (corner[1] >= limit) | (corner[2] >= limit)) {
+                    error = "face references a missing vertex";
+                    return false;
+                }
+                indices.insert(indices.end(), corner, corner + 3);
+            }
+            else if (corners > 3) {
+                std::memcpy(corner, p, 2 * sizeof(uint32_t));
+                for (size_t c = 2; c < corners; ++c) {
+                    std::memcpy(&corner[2], p + 4 * c, sizeof(uint32_t));
+                    if ((corner[0] >= limit) | (corner[1] >= limit) | (corner[2] >= limit)) {
+                        error = "face references a missing vertex";
+                        return false;
+                    }
+                    indices.insert(indices.end(), corner, corner + 3);
+                    corner[1] = corner[2];
+                }
+            }
+            p += 4 * corners;
+        }
+        return true;
+    }
+
+    for (size_t f = 0; f < face.count; ++f) {
+        for (size_t k = 0; k < face.properties.size(); ++k) {
+            const PlyProperty& property = face.properties[k];
+            size_t itemSize = typeSize(property.type);
+            if (!property.isList) {
+                if (size_t(end - p) < itemSize) {
+                    error = "face data is truncated";
+                    return false;
+                }
+                p += itemSize;
+                continue;
+            }
+            size_t countSize = typeSize(property.countType);
+            if (size_t(end - p) < countSize) {
+                error = "face data is truncated";
+                return false;
+            }
+            uint64_t corners = readIndex(p, property.countType, swap);
+            p += countSize;
+            if (corners > size_t(end - p) / itemSize) {
+                error = "face data is truncated";
+                return false;
+            }
+            if (int(k) == listProperty && corners >= 3) {
+                uint64_t first = readIndex(p, property.type, swap);
+                uint64_t previous = readIndex(p + itemSize, property.type, swap);
+                if (first >= vertexCount || previous >= vertexCount) {
+                    error = "face references a missing vertex";
+                    return false;
+                }
+                for (size_t c = 2; c < corners; ++c) {
+                    uint64_t current = readIndex(p + c * itemSize, property.type, swap);
+                    if (current >= vertexCount) {
+                        error = "face references a missing vertex";
+                        return false;
+                    }
+                    indices.push_back(static_cast<unsigned int>(first));
+                    indices.push_back(static_cast<unsigned int>(previous));
+                    indices.push_back(static_cast<unsigned int>(current));
+                    previous = current;
+                }
+            }
+            p += size_t(corners) * itemSize;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+
+bool loadPlyModel(const std::string& filepath, MeshData& meshData, const MeshLoadOptions& options) {
+    if (options.progress) options.progress->stage.store(MeshLoadProgress::PARSING);
+    meshData.clear();
+
+    MappedFile file;
+    if (!file.open(filepath, true)) {
+        std::cerr << "PLY Error: Cannot open file [" << filepath << "]" << std::endl;
+        return false;
+    }
+    PlyHeader header;
+    std::string error;
+    if (!parseHeader(file.data(), file.size(), header, error)) {
+        std::cerr << "PLY Error: " << filepath << ": " << error << std::endl;
+        return false;
+    }
+
+    const unsigned char* p = file.data() + header.dataOffset;
+    const unsigned char* end = file.data() + file.size();
+    const uint16_t one = 1;
+    bool hostBigEndian = *reinterpret_cast<const unsigned char*>(&one) == 0;
+    bool swap = header.bigEndian != hostBigEndian;
+    bool haveVertices = false;
+    for (const PlyElement& element : header.elements) {
+        if (element.name == "vertex" && !haveVertices) {
+            if (!element.fixedSize || element.find("x") < 0 || element.find("y") < 0 || element.find("z") < 0) {
+                error = "vertex element needs fixed-size x, y and z properties";
+                break;
+            }
+            if (element.count > size_t(end - p) / std::max<size_t>(element.stride, 1)) {
+                error = "vertex data is truncated";
+                break;
+            }
+            meshData.vertices.resize(element.count);
+            gatherVertices(element, p, swap, options.parseThreads, meshData.vertices);
+            p += element.count * element.stride;
+            haveVertices = true;
+        }
+        else if (element.name == "face" && haveVertices && meshData.indices.empty()) {
+            if (!readFaces(element, p, end, swap, meshData.vertices.size(), meshData.indices, error)) break;
+        }
+        else if (element.fixedSize) {
+            if (element.count > size_t(end - p) / std::max<size_t>(element.stride, 1)) {
+                error = "element '" + element.name + "' is truncated";
+                break;
+            }
+            p += element.count * element.stride;
+        }
+        else {
+            for (size_t i = 0; i < element.count && p; ++i) p = skipRecord(element, p, end, swap);
+            if (!p) error = "element '" + element.name + "' is truncated";
+        }
+        if (!error.empty()) break;
+    }
+    if (error.empty() && !haveVertices) error = "no vertex element";
+    if (!error.empty()) {
+        std::cerr << "PLY Error: " << filepath << ": " << error << std::endl;
+        meshData.clear();
+        return false;
+    }
+
+    generateNormals(meshData, options.normals);
+    meshData.computeBounds();
+
+    if (meshData.vertices.empty() || meshData.indices.empty()) {
+        std::cerr << "Warning: Loaded PLY file resulted in empty mesh data." << std::endl;
+    }
+    if (options.progress) options.progress->stage.store(MeshLoadProgress::DONE);
+    return true;
+}
@@ -0,0 +1,21 @@
+#ifndef PLY_LOADER_H
+#define PLY_LOADER_H
+
+#include <string>
+
+#include "mesh.h"
+
+// Loads a binary PLY file (little- or big-endian), as produced by range
+// scanners, into MeshData. The "vertex" element must have x/y/z; nx/ny/nz
+// are used when present, otherwise normals are generated as for OBJ. Any
+// other properties and elements are skipped. Faces with more than three
+// corners are fanned into triangles.
+//
+// The file is memory-mapped and the vertex records are gathered into the
+// Vertex array by options.parseThreads workers; nothing is allocated per
+// element. ASCII PLY is reported as an error. loadModel (mesh.h) adds the
+// optimizations and the mesh cache on top, as for OBJ.
+bool loadPlyModel(const std::string& filepath, MeshData& meshData,
+                  const MeshLoadOptions& options = MeshLoadOptions());
+
+#endif
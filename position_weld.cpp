@@ -0,0 +1,134 @@
+#include "position_weld.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+// Tolerances below float precision would only make the grid huge.
+const float MIN_RELATIVE_TOLERANCE = 1e-7f;
+
+// Open-addressing map from a grid cell to the first representative position
+// in it; the rest of the cell's representatives hang off a next[] chain.
+class CellTable {
+public:
+    explicit CellTable(size_t expectedCells) {
+        size_t capacity = 16;
+        while (capacity < expectedCells * 2) capacity <<= 1;
+        slots.assign(capacity, Slot());
+    }
+
+    int* find(int x, int y, int z) {
+        size_t pos = probeStart(x, y, z);
+        for (;;) {
+            Slot& slot = slots[pos];
+            if (slot.head == EMPTY) return nullptr;
+            if (slot.x == x && slot.y == y && slot.z == z) return &slot.head;
+            pos = (pos + 1) & (slots.size() - 1);
+        }
+    }
+
+    // Returns the cell's head, creating an empty (-1) one if needed. The
+    // table is sized for one cell per position, so it never fills up.
+    int& findOrInsert(int x, int y, int z) {
+        size_t pos = probeStart(x, y, z);
+        for (;;) {
+            Slot& slot = slots[pos];
+            if (slot.head == EMPTY) {
+                slot.x = x;
+                slot.y = y;
+                slot.z = z;
+                slot.head = -1;
+                return slot.head;
+            }
+            if (slot.x == x && slot.y == y && slot.z == z) return slot.head;
+            pos = (pos + 1) & (slots.size() - 1);
+        }
+    }
+
+private:
+    static const int EMPTY = -2;
+
+    struct Slot {
+        int x = 0, y = 0, z = 0;
+        int head = EMPTY;
+    };
+
+    size_t probeStart(int x, int y, int z) const {
+        uint64_t h = uint64_t(uint32_t(x)) * 0x9E3779B97F4A7C15ull;
+        h ^= uint64_t(uint32_t(y)) * 0xC2B2AE3D27D4EB4Full;
+        h ^= uint64_t(uint32_t(z)) * 0x165667B19E3779F9ull;
+        h ^= h >> 32;
+        return size_t(h) & (slots.size() - 1);
+    }
+
+    std::vector<Slot> slots;
+};
+
+}  // namespace
+
+
+PositionWeldStats weldPositions(const std::vector<tinyobj::real_t>& positions, float relativeTolerance,
+                                std::vector<int>& remap) {
+    PositionWeldStats stats;
+    size_t count = positions.size() / 3;
+    stats.positions = count;
+    remap.resize(count);
+    for (size_t i = 0; i < count; ++i) remap[i] = static_cast<int>(i);
+    if (count < 2 || !(relativeTolerance > 0.0f)) return stats;
+
+    double boundsMin[3] = { positions[0], positions[1], positions[2] };
+    double boundsMax[3] = { positions[0], positions[1], positions[2] };
+    for (size_t i = 1; i < count; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            boundsMin[k] = std::min<double>(boundsMin[k], positions[3 * i + k]);
+            boundsMax[k] = std::max<double>(boundsMax[k], positions[3 * i + k]);
+        }
+    }
+    double diagonal = std::sqrt((boundsMax[0] - boundsMin[0]) * (boundsMax[0] - boundsMin[0]) +
+                                (boundsMax[1] - boundsMin[1]) * (boundsMax[1] - boundsMin[1]) +
+                                (boundsMax[2] - boundsMin[2]) * (boundsMax[2] - boundsMin[2]));
+    double tolerance = diagonal * std::max(relativeTolerance, MIN_RELATIVE_TOLERANCE);
+    double toleranceSq = tolerance * tolerance;
+    // A zero diagonal means every position is the same point; any cell size
+    // puts them all in one cell.
+    double inverseCell = tolerance > 0.0 ? 1.0 / tolerance : 1.0;
+
+    CellTable cells(count);
+    std::vector<int> next(count, -1);
+
+    for (size_t i = 0; i < count; ++i) {
+        const tinyobj::real_t* p = &positions[3 * i];
+        int cell[3];
+        for (int k = 0; k < 3; ++k) {
+            cell[k] = static_cast<int>(std::floor((p[k] - boundsMin[k]) * inverseCell));
+        }
+
+        int match = -1;
+        for (int dz = -1; dz <= 1; ++dz) {
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    const int* head = cells.find(cell[0] + dx, cell[1] + dy, cell[2] + dz);
+                    if (!head) continue;
+                    for (int r = *head; r >= 0; r = next[r]) {
+                        if (match >= 0 && r > match) continue;
+                        const tinyobj::real_t* q = &positions[3 * size_t(r)];
+                        double ex = double(p[0]) - q[0], ey = double(p[1]) - q[1], ez = double(p[2]) - q[2];
+                        if (ex * ex + ey * ey + ez * ez <= toleranceSq) match = r;
+                    }
+                }
+            }
+        }
+
+        if (match >= 0) {
+            remap[i] = match;
+            ++stats.welded;
+            continue;
+        }
+        int& head = cells.findOrInsert(cell[0], cell[1], cell[2]);
+        next[i] = head;
+        head = static_cast<int>(i);
+    }
+    return stats;
+}
@@ -0,0 +1,27 @@
+#ifndef POSITION_WELD_H
+#define POSITION_WELD_H
+
+#include <cstddef>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+
+struct PositionWeldStats {
+    size_t positions = 0;  // positions in the input array
+    size_t welded = 0;     // positions mapped onto an earlier one
+};
+
+// Merges near-coincident positions of an OBJ position array (x, y, z
+// triples, as in tinyobj::attrib_t::vertices). remap[i] receives the index
+// of the position that i is welded to, which is i itself for the first
+// position of every cluster, so face indices can be rewritten before the
+// (vertex, normal) dedup.
+//
+// relativeTolerance is a fraction of the bounding box diagonal. Positions are
+// binned in a hash grid with that cell size and each one is compared against
+// the representatives in its own and the 26 neighbouring cells; the first
+// one within the tolerance wins, so the result depends on file order only.
+PositionWeldStats weldPositions(const std::vector<tinyobj::real_t>& positions, float relativeTolerance,
+                                std::vector<int>& remap);
+
+#endif
@@ -8,15 +8,26 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 uniform mat3 normalMatrix;
+// Quantized meshes: aNormal.xy is octahedral-encoded (see toon.vert).
+uniform bool octahedralNormals;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
 
+vec3 decodeOctahedral(vec2 e) {
+		vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+		float t = max(-n.z, 0.0);
+		n.x += n.x >= 0.0 ? -t : t;
+		n.y += n.y >= 0.0 ? -t : t;
+		return normalize(n);
+}
+
 void main() {
 
 		FragPos = vec3(model * vec4(aPos, 1.0));
-		Normal  = normalize(normalMatrix * aNormal);
+		vec3 normal = octahedralNormals ? decodeOctahedral(aNormal.xy) : aNormal;
+		Normal  = normalize(normalMatrix * normal);
 
 
 		TexCoord = aTexCoord;
@@ -0,0 +1,13 @@
+#version 330 core
+
+// Flat colour for the silhouette and crease lines; pairs with toon.vert and
+// ignores its outputs.
+
+out vec4 FragColor;
+
+uniform vec3 outlineColor;
+
+void main()
+{
+    FragColor = vec4(outlineColor, 1.0);
+}
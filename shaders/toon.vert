@@ -17,13 +17,27 @@ uniform mat4 projection;
 
 uniform mat3 normalMatrix;
 
+// Set for quantized meshes: aNormal.xy is then an octahedral encoding (z is
+// not supplied), and model already includes the position dequantization.
+uniform bool octahedralNormals;
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main()
 {
     vec4 worldPos = model * vec4(aPos, 1.0);
     vs_out.FragPos = vec3(worldPos);
 
 
-    vs_out.Normal = normalize(normalMatrix * aNormal);
+    vec3 normal = octahedralNormals ? decodeOctahedral(aNormal.xy) : aNormal;
+    vs_out.Normal = normalize(normalMatrix * normal);
 
     gl_Position = projection * view * worldPos;
 }
@@ -0,0 +1,58 @@
+#include "submesh.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+
+void buildSubmeshes(MeshData& meshData, const std::vector<unsigned int>& triangleParts,
+                    const std::vector<int>& triangleMaterials) {
+    std::vector<unsigned int>& indices = meshData.indices;
+    size_t triangleCount = indices.size() / 3;
+    meshData.submeshes.clear();
+    if (triangleCount == 0) return;
+
+    std::vector<unsigned int> parts(triangleParts);
+    std::vector<int> materialIds(triangleMaterials);
+    if (parts.size() != triangleCount || materialIds.size() != triangleCount) {
+        parts.assign(triangleCount, 0u);
+        materialIds.assign(triangleCount, -1);
+    }
+
+    auto before = [&parts, &materialIds](uint32_t a, uint32_t b) {
+        if (materialIds[a] != materialIds[b]) return materialIds[a] < materialIds[b];
+        return parts[a] < parts[b];
+    };
+
+    std::vector<uint32_t> order(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) order[t] = static_cast<uint32_t>(t);
+    // Single-material files are already in order; skip the sort and copy.
+    if (!std::is_sorted(order.begin(), order.end(), before)) {
+        std::stable_sort(order.begin(), order.end(), before);
+        std::vector<unsigned int> sorted(indices.size());
+        for (size_t t = 0; t < triangleCount; ++t) {
+            std::copy(indices.begin() + 3 * size_t(order[t]), indices.begin() + 3 * size_t(order[t]) + 3,
+                      sorted.begin() + 3 * t);
+        }
+        indices.swap(sorted);
+    }
+
+    const std::vector<Vertex>& vertices = meshData.vertices;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        uint32_t source = order[t];
+        if (t == 0 || materialIds[source] != materialIds[order[t - 1]] || parts[source] != parts[order[t - 1]]) {
+            Submesh submesh;
+            submesh.indexOffset = static_cast<unsigned int>(3 * t);
+            submesh.materialId = materialIds[source];
+            submesh.boundsMin = submesh.boundsMax = vertices[indices[3 * t]].Position;
+            meshData.submeshes.push_back(submesh);
+        }
+        Submesh& submesh = meshData.submeshes.back();
+        submesh.indexCount += 3;
+        for (int k = 0; k < 3; ++k) {
+            const glm::vec3& position = vertices[indices[3 * t + k]].Position;
+            submesh.boundsMin = glm::min(submesh.boundsMin, position);
+            submesh.boundsMax = glm::max(submesh.boundsMax, position);
+        }
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef SUBMESH_H
+#define SUBMESH_H
+
+#include <vector>
+
+#include "mesh.h"
+
+// Reorders meshData.indices so that triangles are grouped by material and,
+// within a material, by part (OBJ shape), keeping the file order inside each
+// group, and fills meshData.submeshes with one entry per (material, part)
+// run including its bounds. Both arrays hold one entry per triangle of
+// meshData.indices; if their sizes don't match, the whole mesh becomes a
+// single submesh without a material.
+void buildSubmeshes(MeshData& meshData, const std::vector<unsigned int>& triangleParts,
+                    const std::vector<int>& triangleMaterials);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size worker pool with a FIFO task queue. The destructor finishes
+// every queued task before joining the workers.
+class ThreadPool {
+public:
+    // threadCount == 0 uses one worker per hardware thread.
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    void submit(std::function<void()> task);
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "vertex_cache.h"
+
+#include <vector>
+
+namespace {
+
+const unsigned int UNUSED = 0xFFFFFFFFu;
+
+// Scratch for reordering one index range after another; arrays indexed by
+// vertex are compacted to the vertices the range uses.
+class Tipsify {
+public:
+    explicit Tipsify(size_t vertexCount) : localIndex(vertexCount, UNUSED) {}
+
+    void run(unsigned int* indices, size_t indexCount, unsigned int cacheSize) {
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2) return;
+
+        corners.resize(3 * triangleCount);
+        globalIndex.clear();
+        for (size_t c = 0; c < corners.size(); ++c) {
+            unsigned int& local = localIndex[indices[c]];
+            if (local == UNUSED) {
+                local = static_cast<unsigned int>(globalIndex.size());
+                globalIndex.push_back(indices[c]);
+            }
+            corners[c] = local;
+        }
+        size_t vertexCount = globalIndex.size();
+
+        // Vertex -> triangle adjacency (CSR); live counts the triangles not
+        // yet emitted.
+        live.assign(vertexCount, 0);
+        for (unsigned int v : corners) ++live[v];
+        adjacencyStart.assign(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v) adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+        adjacency.resize(corners.size());
+        fill.assign(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t c = 0; c < corners.size(); ++c) adjacency[fill[corners[c]]++] = static_cast<unsigned int>(c / 3);
+
+        timestamp.assign(vertexCount, 0);
+        emitted.assign(triangleCount, 0);
+        deadEnd.clear();
+        output.clear();
+        unsigned int stamp = cacheSize + 1;
+        size_t cursor = 1;
+        long fanning = 0;
+        while (fanning >= 0) {
+            candidates.clear();
+            for (unsigned int a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; ++a) {
+                unsigned int t = adjacency[a];
+                if (emitted[t]) continue;
+                emitted[t] = 1;
+                for (int k = 0; k < 3; ++k) {
+                    unsigned int v = corners[3 * t + k];
+                    output.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    --live[v];
+                    if (stamp - timestamp[v] > cacheSize) timestamp[v] = stamp++;
+                }
+            }
+
+            // Prefer the candidate that entered the cache earliest among those
+            // whose remaining fan still fits before it is evicted.
+            fanning = -1;
+            long bestPriority = -1;
+            for (unsigned int v : candidates) {
+                if (live[v] == 0) continue;
+                long priority = 0;
+                if (stamp - timestamp[v] + 2 * live[v] <= cacheSize) priority = stamp - timestamp[v];
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    fanning = v;
+                }
+            }
+            while (fanning < 0 && !deadEnd.empty()) {
+                unsigned int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) fanning = v;
+            }
+            while (fanning < 0 && cursor < vertexCount) {
+                if (live[cursor] > 0) fanning = static_cast<long>(cursor);
+                else ++cursor;
+            }
+        }
+
+        for (size_t c = 0; c < output.size(); ++c) indices[c] = globalIndex[output[c]];
+        for (unsigned int g : globalIndex) localIndex[g] = UNUSED;
+    }
+
+private:
+    std::vector<unsigned int> localIndex;  // UNUSED outside run()
+    std::vector<unsigned int> globalIndex;
+    std::vector<unsigned int> corners;
+    std::vector<unsigned int> live;
+    std::vector<unsigned int> adjacencyStart;
+    std::vector<unsigned int> adjacency;
+    std::vector<unsigned int> fill;
+    std::vector<unsigned int> timestamp;
+    std::vector<unsigned char> emitted;
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+};
+
+}  // namespace
+
+
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                    unsigned int cacheSize) {
+    VertexCacheStats stats;
+    std::vector<unsigned int> timestamp(vertexCount, 0);
+    unsigned int stamp = cacheSize + 1;
+    size_t referenced = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        unsigned int& entered = timestamp[indices[i]];
+        if (entered == 0) ++referenced;
+        if (stamp - entered > cacheSize) {
+            entered = stamp++;
+            ++stats.transformed;
+        }
+    }
+    if (indexCount >= 3) stats.acmr = double(stats.transformed) / double(indexCount / 3);
+    if (referenced > 0) stats.atvr = double(stats.transformed) / double(referenced);
+    return stats;
+}
+
+void optimizeVertexCache(unsigned int* indices, const std::vector<Submesh>& ranges, size_t vertexCount,
+                         unsigned int cacheSize) {
+    Tipsify tipsify(vertexCount);
+    for (const Submesh& range : ranges) {
+        tipsify.run(indices + range.indexOffset, range.indexCount, cacheSize);
+    }
+}
+
+void optimizeVertexCache(MeshData& meshData, unsigned int cacheSize) {
+    std::vector<Submesh> ranges = meshData.submeshes;
+    if (ranges.empty()) {
+        ranges.resize(1);
+        ranges[0].indexCount = static_cast<unsigned int>(meshData.baseIndexCount());
+    }
+    optimizeVertexCache(meshData.indices.data(), ranges, meshData.vertexCount(), cacheSize);
+}
@@ -0,0 +1,35 @@
+#ifndef VERTEX_CACHE_H
+#define VERTEX_CACHE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "mesh.h"
+
+// Post-transform cache efficiency of an index buffer, simulated as a FIFO
+// of cacheSize vertices.
+struct VertexCacheStats {
+    size_t transformed = 0;  // cache misses = vertex shader invocations
+    double acmr = 0.0;       // transformed per triangle (0.5 is the ideal for a large grid)
+    double atvr = 0.0;       // transformed per referenced vertex (1.0 is the ideal)
+};
+
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                    unsigned int cacheSize = 16);
+
+// Reorders the triangles inside each submesh (all full-resolution triangles
+// if there are none) with Tipsify (Sander, Nehab & Barczak, "Fast Triangle
+// Reordering for Vertex Locality and Reduced Overdraw", 2007): fan out
+// around the vertex most recently put in the cache, then jump to the live
+// vertex that will still be cached, and only then fall back to a dead-end
+// stack. Linear time; triangle winding and submesh ranges are unchanged.
+//
+// meshData.indices must hold the indices (not a mapping). LOD levels are
+// left alone; generateLods orders them itself.
+void optimizeVertexCache(MeshData& meshData, unsigned int cacheSize = 16);
+
+// The same for the index ranges of an arbitrary index array.
+void optimizeVertexCache(unsigned int* indices, const std::vector<Submesh>& ranges, size_t vertexCount,
+                         unsigned int cacheSize = 16);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef VERTEX_DEDUP_H
+#define VERTEX_DEDUP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Flat open-addressing map from an OBJ (vertex, normal, texcoord) index tuple
+// to the index of the deduplicated vertex built from it. Replaces the
+// std::to_string keyed unordered_map the loaders used to build per corner.
+class VertexDedupTable {
+public:
+    // expectedKeys is an upper bound on the number of distinct tuples; the
+    // table is sized once for it and only grows if the estimate was too low.
+    explicit VertexDedupTable(size_t expectedKeys) : count(0) {
+        size_t capacity = 16;
+        while (capacity < expectedKeys * 2) capacity <<= 1;
+        slots.assign(capacity, Slot());
+    }
+
+    // Looks the tuple up once; if absent it is stored with newIndex.
+    // Returns the index that the tuple maps to either way.
+    unsigned int findOrInsert(int vertexIndex, int normalIndex, int texcoordIndex,
+                              unsigned int newIndex, bool& inserted) {
+        if ((count + 1) * 2 > slots.size()) grow();
+
+        size_t mask = slots.size() - 1;
+        size_t pos = hashKey(vertexIndex, normalIndex, texcoordIndex) & mask;
+        for (;;) {
+            Slot& slot = slots[pos];
+            if (slot.value == EMPTY) {
+                slot.vertexIndex = vertexIndex;
+                slot.normalIndex = normalIndex;
+                slot.texcoordIndex = texcoordIndex;
+                slot.value = newIndex;
+                ++count;
+                inserted = true;
+                return newIndex;
+            }
+            if (slot.vertexIndex == vertexIndex && slot.normalIndex == normalIndex &&
+                slot.texcoordIndex == texcoordIndex) {
+                inserted = false;
+                return slot.value;
+            }
+            pos = (pos + 1) & mask;
+        }
+    }
+
+    size_t size() const { return count; }
+
+private:
+    static const unsigned int EMPTY = 0xFFFFFFFFu;
+
+    struct Slot {
+        int vertexIndex = -1;
+        int normalIndex = -1;
+        int texcoordIndex = -1;
+        unsigned int value = EMPTY;
+    };
+
+    static size_t hashKey(int v, int n, int t) {
+        uint64_t h = (uint64_t(uint32_t(v)) << 32) | uint32_t(n);
+        h ^= uint64_t(uint32_t(t)) * 0x9E3779B97F4A7C15ull;
+        // murmur3 finalizer, so sequential indices spread over the table
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return size_t(h);
+    }
+
+    void grow() {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(old.size() * 2, Slot());
+        size_t mask = slots.size() - 1;
+        for (const Slot& s : old) {
+            if (s.value == EMPTY) continue;
+            size_t pos = hashKey(s.vertexIndex, s.normalIndex, s.texcoordIndex) & mask;
+            while (slots[pos].value != EMPTY) pos = (pos + 1) & mask;
+            slots[pos] = s;
+        }
+    }
+
+    std::vector<Slot> slots;
+    size_t count;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "vertex_fetch.h"
+
+#include <vector>
+
+size_t optimizeVertexFetch(MeshData& meshData) {
+    const unsigned int UNUSED = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(meshData.vertices.size(), UNUSED);
+    std::vector<Vertex> reordered;
+    reordered.reserve(meshData.vertices.size());
+    for (unsigned int& index : meshData.indices) {
+        unsigned int& target = remap[index];
+        if (target == UNUSED) {
+            target = static_cast<unsigned int>(reordered.size());
+            reordered.push_back(meshData.vertices[index]);
+        }
+        index = target;
+    }
+    size_t dropped = meshData.vertices.size() - reordered.size();
+    meshData.vertices.swap(reordered);
+    return dropped;
+}
@@ -0,0 +1,16 @@
+#ifndef VERTEX_FETCH_H
+#define VERTEX_FETCH_H
+
+#include <cstddef>
+
+#include "mesh.h"
+
+// Renumbers the vertices in the order the index buffer first uses them and
+// rewrites both arrays, so the vertex fetches of a draw walk the VBO almost
+// sequentially. Run it after every pass that reorders triangles. Vertices no
+// triangle uses are dropped; returns how many.
+//
+// meshData.vertices and meshData.indices must hold the data (not a mapping).
+size_t optimizeVertexFetch(MeshData& meshData);
+
+#endif
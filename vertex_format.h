@@ -0,0 +1,177 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Compile-time vertex layouts. A format is a list of attributes, e.g.
+//
+//     typedef PackedVertex<PositionAttribute, NormalAttribute> Vertex;
+//
+// and each attribute contributes its named member (vertex.Position, ...),
+// its part of the OBJ dedup key, its fill code and its shader location. The
+// struct holds exactly those members with no padding, and the per-corner
+// loader code is expanded per format instead of testing which attributes
+// exist at run time.
+
+// The OBJ attribute arrays a vertex is filled from (tinyobj's attrib_t
+// layout). Formats without texcoords can pass an empty vector.
+template <typename Real>
+struct ObjArrays {
+    const std::vector<Real>& positions;
+    const std::vector<Real>& normals;
+    const std::vector<Real>& texcoords;
+};
+
+// How an attribute's components are stored; the normalized integer types
+// reach the shader as floats in [0, 1] and [-1, 1].
+enum VertexComponentType { FLOAT32, UNORM16, SNORM16 };
+
+// One attribute as the GL setup sees it.
+struct VertexAttributeLayout {
+    unsigned int location;
+    int components;
+    VertexComponentType type;
+    size_t offset;
+};
+
+struct PositionAttribute {
+    static const unsigned int location = 0;
+    static const int components = 3;
+    static const VertexComponentType type = FLOAT32;
+    glm::vec3 Position;
+
+    template <typename Index>
+    static void copyKey(const Index& idx, Index& key) { key.vertex_index = idx.vertex_index; }
+
+    template <typename Real, typename Index>
+    void fillFromObj(const ObjArrays<Real>& obj, const Index& idx) {
+        if (idx.vertex_index < 0 || 3 * size_t(idx.vertex_index) + 2 >= obj.positions.size()) {
+            throw std::runtime_error("Invalid vertex index in OBJ file.");
+        }
+        const Real* p = &obj.positions[3 * size_t(idx.vertex_index)];
+        Position = glm::vec3(p[0], p[1], p[2]);
+    }
+};
+
+struct NormalAttribute {
+    static const unsigned int location = 1;
+    static const int components = 3;
+    static const VertexComponentType type = FLOAT32;
+    glm::vec3 Normal;
+
+    template <typename Index>
+    static void copyKey(const Index& idx, Index& key) { key.normal_index = idx.normal_index; }
+
+    // Corners without a normal get (0, 0, 0); loaders fill those in later
+    // (see generateNormals).
+    template <typename Real, typename Index>
+    void fillFromObj(const ObjArrays<Real>& obj, const Index& idx) {
+        if (idx.normal_index >= 0 && 3 * size_t(idx.normal_index) + 2 < obj.normals.size()) {
+            const Real* n = &obj.normals[3 * size_t(idx.normal_index)];
+            Normal = glm::vec3(n[0], n[1], n[2]);
+        }
+        else {
+            Normal = glm::vec3(0.0f);
+        }
+    }
+};
+
+struct TexCoordAttribute {
+    static const unsigned int location = 2;
+    static const int components = 2;
+    static const VertexComponentType type = FLOAT32;
+    glm::vec2 TexCoords;
+
+    template <typename Index>
+    static void copyKey(const Index& idx, Index& key) { key.texcoord_index = idx.texcoord_index; }
+
+    template <typename Real, typename Index>
+    void fillFromObj(const ObjArrays<Real>& obj, const Index& idx) {
+        if (idx.texcoord_index >= 0 && 2 * size_t(idx.texcoord_index) + 1 < obj.texcoords.size()) {
+            const Real* t = &obj.texcoords[2 * size_t(idx.texcoord_index)];
+            TexCoords = glm::vec2(t[0], t[1]);
+        }
+        else {
+            TexCoords = glm::vec2(0.0f);
+        }
+    }
+};
+
+// Compact GPU-side attributes (see vertex_quantize.h). They have no OBJ
+// fill code; vertices are converted from Vertex after loading.
+struct QuantizedPositionAttribute {
+    static const unsigned int location = 0;
+    static const int components = 3;
+    static const VertexComponentType type = UNORM16;
+    // x, y, z relative to the mesh bounding box; [3] pads to 8 bytes.
+    uint16_t QuantizedPosition[4];
+};
+
+struct OctahedralNormalAttribute {
+    static const unsigned int location = 1;
+    static const int components = 2;
+    static const VertexComponentType type = SNORM16;
+    int16_t OctahedralNormal[2];
+};
+
+template <typename... Attributes>
+struct AttributeBytes;
+
+template <>
+struct AttributeBytes<> {
+    static const size_t value = 0;
+};
+
+template <typename First, typename... Rest>
+struct AttributeBytes<First, Rest...> {
+    static const size_t value = sizeof(First) + AttributeBytes<Rest...>::value;
+};
+
+template <typename... Attributes>
+struct PackedVertex : Attributes... {
+    static const size_t attributeCount = sizeof...(Attributes);
+
+    // The OBJ index tuple that identifies a distinct vertex of this format:
+    // indices of attributes the format doesn't have are -1, so e.g. texture
+    // seams don't split a position+normal vertex.
+    template <typename Index>
+    static Index dedupKey(const Index& idx) {
+        Index key;
+        key.vertex_index = key.normal_index = key.texcoord_index = -1;
+        int expand[] = { 0, (Attributes::copyKey(idx, key), 0)... };
+        (void)expand;
+        return key;
+    }
+
+    template <typename Real, typename Index>
+    static PackedVertex fromObj(const ObjArrays<Real>& obj, const Index& idx) {
+        PackedVertex vertex;
+        int expand[] = { 0, (static_cast<Attributes&>(vertex).fillFromObj(obj, idx), 0)... };
+        (void)expand;
+        return vertex;
+    }
+
+    template <typename Attribute>
+    static size_t offsetOf() {
+        const PackedVertex probe = PackedVertex();
+        return size_t(reinterpret_cast<const char*>(static_cast<const Attribute*>(&probe)) -
+                      reinterpret_cast<const char*>(&probe));
+    }
+
+    static std::array<VertexAttributeLayout, sizeof...(Attributes)> layout() {
+        static_assert(sizeof(PackedVertex) == AttributeBytes<Attributes...>::value,
+                      "vertex attributes must pack without padding");
+        std::array<VertexAttributeLayout, sizeof...(Attributes)> attributes = { {
+            { Attributes::location, Attributes::components, Attributes::type, offsetOf<Attributes>() }...
+        } };
+        return attributes;
+    }
+};
+
+#endif
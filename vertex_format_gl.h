@@ -0,0 +1,21 @@
+#ifndef VERTEX_FORMAT_GL_H
+#define VERTEX_FORMAT_GL_H
+
+#include <GL/glew.h>
+
+#include "vertex_format.h"
+
+// Points the bound VAO's attributes at the bound GL_ARRAY_BUFFER, laid out
+// as VertexType (a PackedVertex), and enables them.
+template <typename VertexType>
+void setVertexAttributes() {
+    for (const VertexAttributeLayout& attribute : VertexType::layout()) {
+        GLenum type = attribute.type == UNORM16 ? GL_UNSIGNED_SHORT : attribute.type == SNORM16 ? GL_SHORT : GL_FLOAT;
+        GLboolean normalized = attribute.type == FLOAT32 ? GL_FALSE : GL_TRUE;
+        glVertexAttribPointer(attribute.location, attribute.components, type, normalized, sizeof(VertexType),
+                              reinterpret_cast<const void*>(attribute.offset));
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
+
+#endif
@@ -0,0 +1,89 @@
+#include "vertex_quantize.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+uint16_t toUnorm16(float value) {
+    return static_cast<uint16_t>(std::lround(std::max(0.0f, std::min(1.0f, value)) * 65535.0f));
+}
+
+int16_t toSnorm16(float value) {
+    return static_cast<int16_t>(std::lround(std::max(-1.0f, std::min(1.0f, value)) * 32767.0f));
+}
+
+float signNotZero(float value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+}  // namespace
+
+
+glm::vec2 encodeOctahedral(const glm::vec3& normal) {
+    float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (l1 == 0.0f) return glm::vec2(0.0f);
+    glm::vec2 p(normal.x / l1, normal.y / l1);
+    if (normal.z < 0.0f) {
+        // Fold the lower hemisphere over the diagonals.
+        p = glm::vec2((1.0f - std::fabs(p.y)) * signNotZero(p.x), (1.0f - std::fabs(p.x)) * signNotZero(p.y));
+    }
+    return p;
+}
+
+glm::vec3 decodeOctahedral(const glm::vec2& encoded) {
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - std::fabs(encoded.x) - std::fabs(encoded.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+glm::mat4 quantizeVertices(const MeshData& meshData, std::vector<QuantizedVertex>& quantized) {
+    glm::mat4 positionTransform = quantizationTransform(meshData);
+    quantized.resize(meshData.vertexCount());
+    quantizeVertexRange(meshData, positionTransform, 0, quantized.size(), quantized.data());
+    return positionTransform;
+}
+
+glm::mat4 quantizationTransform(const MeshData& meshData) {
+    const Vertex* vertices = meshData.vertexData();
+    size_t count = meshData.vertexCount();
+    glm::vec3 lo(0.0f), hi(0.0f);
+    if (count > 0) lo = hi = vertices[0].Position;
+    for (size_t v = 1; v < count; ++v) {
+        lo = glm::min(lo, vertices[v].Position);
+        hi = glm::max(hi, vertices[v].Position);
+    }
+
+    // Column-major: scale by the box extent, then translate to its corner.
+    glm::vec3 extent = hi - lo;
+    glm::mat4 positionTransform(1.0f);
+    positionTransform[0][0] = extent.x;
+    positionTransform[1][1] = extent.y;
+    positionTransform[2][2] = extent.z;
+    positionTransform[3] = glm::vec4(lo, 1.0f);
+    return positionTransform;
+}
+
+void quantizeVertexRange(const MeshData& meshData, const glm::mat4& positionTransform, size_t first, size_t count,
+                         QuantizedVertex* quantized, const unsigned int* vertexIds) {
+    const Vertex* vertices = meshData.vertexData();
+    glm::vec3 lo(positionTransform[3]);
+    glm::vec3 extent(positionTransform[0][0], positionTransform[1][1], positionTransform[2][2]);
+    glm::vec3 inverse(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+                      extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+    for (size_t v = 0; v < count; ++v) {
+        const Vertex& vertex = vertices[vertexIds ? vertexIds[first + v] : first + v];
+        glm::vec3 unit = (vertex.Position - lo) * inverse;
+        QuantizedVertex& q = quantized[v];
+        q.QuantizedPosition[0] = toUnorm16(unit.x);
+        q.QuantizedPosition[1] = toUnorm16(unit.y);
+        q.QuantizedPosition[2] = toUnorm16(unit.z);
+        q.QuantizedPosition[3] = 0;
+        glm::vec2 octahedral = encodeOctahedral(vertex.Normal);
+        q.OctahedralNormal[0] = toSnorm16(octahedral.x);
+        q.OctahedralNormal[1] = toSnorm16(octahedral.y);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef VERTEX_QUANTIZE_H
+#define VERTEX_QUANTIZE_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "mesh.h"
+
+// 12-byte GPU vertex: the position as three 16-bit fractions of the
+// bounding box and the normal octahedral-encoded into two 16-bit snorms,
+// half the size of Vertex. The shaders decode the normal when their
+// octahedralNormals uniform is set; the returned positionTransform takes the
+// positions back to mesh space and goes into the model matrix.
+typedef PackedVertex<QuantizedPositionAttribute, OctahedralNormalAttribute> QuantizedVertex;
+
+// Fills quantized from the mesh's vertices and returns positionTransform.
+// Positions are exact to 1/65535 of the box; normals to about 0.005 degrees.
+glm::mat4 quantizeVertices(const MeshData& meshData, std::vector<QuantizedVertex>& quantized);
+
+// The same in pieces, for uploads spread over several frames: the transform
+// quantizeVertices would return, and the conversion of vertices
+// [first, first + count) for it. With vertexIds, the vertices converted are
+// the ones it lists at those positions (e.g. MeshData::chunkVertices).
+glm::mat4 quantizationTransform(const MeshData& meshData);
+void quantizeVertexRange(const MeshData& meshData, const glm::mat4& positionTransform, size_t first, size_t count,
+                         QuantizedVertex* quantized, const unsigned int* vertexIds = nullptr);
+
+// The octahedral mapping of a unit vector onto [-1, 1]^2, and back; the GLSL
+// decode in toon.vert and crosshatch.vert matches decodeOctahedral.
+glm::vec2 encodeOctahedral(const glm::vec3& normal);
+glm::vec3 decodeOctahedral(const glm::vec2& encoded);
+
+#endif